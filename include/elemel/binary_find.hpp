@@ -21,21 +21,528 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/simd.hpp>
+#include <elemel/detail/type_traits.hpp>
+
 #include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
 
 namespace elemel {
+    namespace detail {
+        struct less {
+            template <class Left, class Right>
+            bool operator()(Left const &left, Right const &right) const
+            {
+                return left < right;
+            }
+        };
+
+        // Halves the range without branching on the comparison, and
+        // prefetches both candidates for the next step.
+        template <class RandomAccessIterator, class T, class Compare>
+        RandomAccessIterator branchless_lower_bound(RandomAccessIterator first,
+                                                    RandomAccessIterator last,
+                                                    T const &value,
+                                                    Compare comp)
+        {
+            typedef typename std::iterator_traits<RandomAccessIterator>::
+                difference_type difference_type;
+
+            difference_type n = last - first;
+            if (n == 0) {
+                return first;
+            }
+            while (n > 1) {
+                difference_type half = n / 2;
+                ELEMEL_PREFETCH(&*(first + half / 2));
+                ELEMEL_PREFETCH(&*(first + half + half / 2));
+                first = comp(*(first + half), value) ? first + half : first;
+                n -= half;
+            }
+            return first + comp(*first, value);
+        }
+
+        template <class T>
+        std::size_t count_less(T const *first, std::size_t n, T const &value)
+        {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+#if defined(ELEMEL_SSE2)
+        inline std::size_t count_less(int const *first, std::size_t n,
+                                      int value)
+        {
+            std::size_t result = 0;
+            std::size_t i = 0;
+#if defined(ELEMEL_AVX2)
+            __m256i value8 = _mm256_set1_epi32(value);
+            for (; i + 8 <= n; i += 8) {
+                __m256i x = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(first + i));
+                __m256i mask = _mm256_cmpgt_epi32(value8, x);
+                result += __builtin_popcount(
+                    _mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+            }
+#endif
+            __m128i value4 = _mm_set1_epi32(value);
+            for (; i + 4 <= n; i += 4) {
+                __m128i x = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first + i));
+                __m128i mask = _mm_cmplt_epi32(x, value4);
+                result += __builtin_popcount(
+                    _mm_movemask_ps(_mm_castsi128_ps(mask)));
+            }
+            for (; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+        inline std::size_t count_less(unsigned int const *first,
+                                      std::size_t n, unsigned int value)
+        {
+            // Flip the sign bits to compare unsigned values as signed.
+            std::size_t result = 0;
+            std::size_t i = 0;
+            __m128i bias = _mm_set1_epi32(int(0x80000000u));
+            __m128i value4 = _mm_xor_si128(_mm_set1_epi32(int(value)), bias);
+            for (; i + 4 <= n; i += 4) {
+                __m128i x = _mm_xor_si128(_mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first + i)), bias);
+                __m128i mask = _mm_cmplt_epi32(x, value4);
+                result += __builtin_popcount(
+                    _mm_movemask_ps(_mm_castsi128_ps(mask)));
+            }
+            for (; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+        inline std::size_t count_less(float const *first, std::size_t n,
+                                      float value)
+        {
+            std::size_t result = 0;
+            std::size_t i = 0;
+#if defined(ELEMEL_AVX2)
+            __m256 value8 = _mm256_set1_ps(value);
+            for (; i + 8 <= n; i += 8) {
+                __m256 mask = _mm256_cmp_ps(_mm256_loadu_ps(first + i),
+                                            value8, _CMP_LT_OQ);
+                result += __builtin_popcount(_mm256_movemask_ps(mask));
+            }
+#endif
+            __m128 value4 = _mm_set1_ps(value);
+            for (; i + 4 <= n; i += 4) {
+                __m128 mask = _mm_cmplt_ps(_mm_loadu_ps(first + i), value4);
+                result += __builtin_popcount(_mm_movemask_ps(mask));
+            }
+            for (; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+        inline std::size_t count_less(double const *first, std::size_t n,
+                                      double value)
+        {
+            std::size_t result = 0;
+            std::size_t i = 0;
+#if defined(ELEMEL_AVX2)
+            __m256d value4 = _mm256_set1_pd(value);
+            for (; i + 4 <= n; i += 4) {
+                __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(first + i),
+                                             value4, _CMP_LT_OQ);
+                result += __builtin_popcount(_mm256_movemask_pd(mask));
+            }
+#endif
+            __m128d value2 = _mm_set1_pd(value);
+            for (; i + 2 <= n; i += 2) {
+                __m128d mask = _mm_cmplt_pd(_mm_loadu_pd(first + i), value2);
+                result += __builtin_popcount(_mm_movemask_pd(mask));
+            }
+            for (; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+#if defined(ELEMEL_SSE4_2)
+        template <class T>
+        std::size_t count_less_64(T const *first, std::size_t n, T value)
+        {
+            std::size_t result = 0;
+            std::size_t i = 0;
+#if defined(ELEMEL_AVX2)
+            __m256i value4 = _mm256_set1_epi64x(value);
+            for (; i + 4 <= n; i += 4) {
+                __m256i x = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(first + i));
+                __m256i mask = _mm256_cmpgt_epi64(value4, x);
+                result += __builtin_popcount(
+                    _mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+            }
+#endif
+            __m128i value2 = _mm_set1_epi64x(value);
+            for (; i + 2 <= n; i += 2) {
+                __m128i x = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first + i));
+                __m128i mask = _mm_cmpgt_epi64(value2, x);
+                result += __builtin_popcount(
+                    _mm_movemask_pd(_mm_castsi128_pd(mask)));
+            }
+            for (; i < n; ++i) {
+                result += (first[i] < value);
+            }
+            return result;
+        }
+
+        inline std::size_t count_less(long long const *first, std::size_t n,
+                                      long long value)
+        {
+            return count_less_64(first, n, value);
+        }
+
+#if __SIZEOF_LONG__ == 8
+        inline std::size_t count_less(long const *first, std::size_t n,
+                                      long value)
+        {
+            return count_less_64(first, n, value);
+        }
+#endif
+#endif
+#endif
+
+        // Narrows the range down to about a cache line without branching,
+        // and then counts the smaller elements in it with vector compares.
+        template <class T>
+        T const *arithmetic_lower_bound(T const *first, T const *last,
+                                        T const &value)
+        {
+            std::size_t const window = (ELEMEL_CACHE_LINE_SIZE / sizeof(T) > 1 ?
+                                        ELEMEL_CACHE_LINE_SIZE / sizeof(T) : 1);
+            std::size_t n = last - first;
+            while (n > window) {
+                std::size_t half = n / 2;
+                ELEMEL_PREFETCH(first + half / 2);
+                ELEMEL_PREFETCH(first + half + half / 2);
+                first = (first[half] < value) ? first + half : first;
+                n -= half;
+            }
+            return first + count_less(first, n, value);
+        }
+
+        // Tells if a search for a value of type U among elements of type T,
+        // ordered by Compare, can use the arithmetic search.
+        template <class T, class U, class Compare>
+        struct is_arithmetic_search : false_type { };
+
+        template <class T>
+        struct is_arithmetic_search<T, T, less> : is_arithmetic<T>
+        { };
+
+        template <class T>
+        struct is_arithmetic_search<T, T, std::less<T> > :
+            is_arithmetic<T>
+        { };
+
+        template <class T, class U, class Compare>
+        struct is_arithmetic_search<T const, U, Compare> :
+            is_arithmetic_search<T, U, Compare>
+        { };
+
+        template <class T, class U, class Compare>
+        T *pointer_lower_bound(T *first, T *last, U const &value,
+                               Compare comp, true_type)
+        {
+            T const *result = arithmetic_lower_bound(
+                static_cast<T const *>(first), static_cast<T const *>(last),
+                value);
+            return first + (result - first);
+        }
+
+        template <class T, class U, class Compare>
+        T *pointer_lower_bound(T *first, T *last, U const &value,
+                               Compare comp, false_type)
+        {
+            return branchless_lower_bound(first, last, value, comp);
+        }
+
+        template <class ForwardIterator, class T, class Compare>
+        ForwardIterator lower_bound(ForwardIterator first,
+                                    ForwardIterator last, T const &value,
+                                    Compare comp, std::forward_iterator_tag)
+        {
+            return std::lower_bound(first, last, value, comp);
+        }
+
+        template <class RandomAccessIterator, class T, class Compare>
+        RandomAccessIterator lower_bound(RandomAccessIterator first,
+                                         RandomAccessIterator last,
+                                         T const &value, Compare comp,
+                                         std::random_access_iterator_tag)
+        {
+            return branchless_lower_bound(first, last, value, comp);
+        }
+
+        template <class T, class U, class Compare>
+        T *lower_bound(T *first, T *last, U const &value, Compare comp,
+                       std::random_access_iterator_tag)
+        {
+            typedef typename is_arithmetic_search<T, U, Compare>::type
+                is_arithmetic_search_type;
+
+            return pointer_lower_bound(first, last, value, comp,
+                                       is_arithmetic_search_type());
+        }
+
+        template <class ForwardIterator, class T, class Compare>
+        ForwardIterator binary_find(ForwardIterator first,
+                                    ForwardIterator last, T const &value,
+                                    Compare comp, false_type)
+        {
+            typedef typename std::iterator_traits<ForwardIterator>::
+                iterator_category iterator_category;
+
+            ForwardIterator i = detail::lower_bound(first, last, value, comp,
+                                                    iterator_category());
+            return (i != last && !comp(value, *i)) ? i : last;
+        }
+
+        // Stops at the first element that compares equal, so each step
+        // costs a single three-way comparison and no final check is needed.
+        // For keys such as strings, the comparisons dominate the cost of the
+        // search.
+        template <class ForwardIterator, class T, class Compare>
+        ForwardIterator binary_find(ForwardIterator first,
+                                    ForwardIterator last, T const &value,
+                                    Compare comp, true_type)
+        {
+            typedef typename std::iterator_traits<ForwardIterator>::
+                difference_type difference_type;
+
+            difference_type n = std::distance(first, last);
+            while (n > 0) {
+                difference_type half = n / 2;
+                ForwardIterator middle = first;
+                std::advance(middle, half);
+                int result =
+                    three_way_compare<Compare>::compare(comp, *middle, value);
+                if (result < 0) {
+                    first = ++middle;
+                    n -= half + 1;
+                } else if (result > 0) {
+                    n = half;
+                } else {
+                    return middle;
+                }
+            }
+            return last;
+        }
+
+        template <class Compare, class Left, class Right>
+        bool equivalent(Compare const &comp, Left const &left,
+                        Right const &right, false_type)
+        {
+            return !comp(left, right) && !comp(right, left);
+        }
+
+        template <class Compare, class Left, class Right>
+        bool equivalent(Compare const &comp, Left const &left,
+                        Right const &right, true_type)
+        {
+            return three_way_compare<Compare>::compare(comp, left, right) == 0;
+        }
+
+        // Tells if neither value is ordered before the other, with a single
+        // comparison if the ordering can compare in three ways.
+        template <class Compare, class Left, class Right>
+        bool equivalent(Compare const &comp, Left const &left,
+                        Right const &right)
+        {
+            return equivalent(comp, left, right,
+                              typename three_way_compare<Compare>::type());
+        }
+
+        template <class ForwardIterator, class Compare>
+        bool is_sorted(ForwardIterator first, ForwardIterator last,
+                       Compare comp)
+        {
+            if (first != last) {
+                for (ForwardIterator next = first; ++next != last; ++first) {
+                    if (comp(*next, *first)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Searches for sorted keys in a single forward pass, galloping from
+        // the previous match.
+        template <class RandomAccessIterator, class ForwardIterator,
+                  class OutputIterator, class Compare>
+        OutputIterator merge_find_many(RandomAccessIterator first,
+                                       RandomAccessIterator last,
+                                       ForwardIterator keys_first,
+                                       ForwardIterator keys_last,
+                                       OutputIterator out, Compare comp)
+        {
+            typedef typename std::iterator_traits<RandomAccessIterator>::
+                difference_type difference_type;
+
+            for (; keys_first != keys_last; ++keys_first) {
+                difference_type n = last - first;
+                difference_type bound = 1;
+                while (bound < n && comp(*(first + bound), *keys_first)) {
+                    bound *= 2;
+                }
+                first = branchless_lower_bound(first + bound / 2,
+                                               first + std::min(bound, n),
+                                               *keys_first, comp);
+                *out = ((first != last && !comp(*keys_first, *first)) ?
+                        first : last);
+                ++out;
+            }
+            return out;
+        }
+
+        // Runs the searches for a group of keys in lockstep, so that their
+        // cache misses overlap instead of following each other.
+        template <class RandomAccessIterator, class ForwardIterator,
+                  class OutputIterator, class Compare>
+        OutputIterator interleaved_find_many(RandomAccessIterator first,
+                                             RandomAccessIterator last,
+                                             ForwardIterator keys_first,
+                                             ForwardIterator keys_last,
+                                             OutputIterator out, Compare comp)
+        {
+            typedef typename std::iterator_traits<RandomAccessIterator>::
+                difference_type difference_type;
+
+            enum { group_size = 8 };
+            ForwardIterator keys[group_size];
+            RandomAccessIterator bases[group_size];
+            while (keys_first != keys_last) {
+                int m = 0;
+                for (; m < group_size && keys_first != keys_last;
+                     ++m, ++keys_first)
+                {
+                    keys[m] = keys_first;
+                    bases[m] = first;
+                }
+                difference_type n = last - first;
+                if (n != 0) {
+                    while (n > 1) {
+                        difference_type half = n / 2;
+                        for (int j = 0; j < m; ++j) {
+                            ELEMEL_PREFETCH(&*(bases[j] + half / 2));
+                            ELEMEL_PREFETCH(&*(bases[j] + half + half / 2));
+                        }
+                        for (int j = 0; j < m; ++j) {
+                            bases[j] = (comp(*(bases[j] + half), *keys[j]) ?
+                                        bases[j] + half : bases[j]);
+                        }
+                        n -= half;
+                    }
+                    for (int j = 0; j < m; ++j) {
+                        bases[j] += comp(*bases[j], *keys[j]);
+                    }
+                }
+                for (int j = 0; j < m; ++j) {
+                    *out = ((bases[j] != last && !comp(*keys[j], *bases[j])) ?
+                            bases[j] : last);
+                    ++out;
+                }
+            }
+            return out;
+        }
+    }
+
+    // Like std::lower_bound, but dispatches at compile time to a branchless
+    // search for random access iterators, and to a vectorized search for
+    // pointers to arithmetic values compared with operator< or std::less.
+    template <class ForwardIterator, class T>
+    ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last,
+                                T const &value)
+    {
+        typedef typename std::iterator_traits<ForwardIterator>::
+            iterator_category iterator_category;
+
+        return detail::lower_bound(first, last, value, detail::less(),
+                                   iterator_category());
+    }
+
+    template <class ForwardIterator, class T, class Compare>
+    ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last,
+                                T const &value, Compare comp)
+    {
+        typedef typename std::iterator_traits<ForwardIterator>::
+            iterator_category iterator_category;
+
+        return detail::lower_bound(first, last, value, comp,
+                                   iterator_category());
+    }
+
+    // Finds an element equivalent to value in a sorted range, with a single
+    // search followed by a single comparison.
     template <class ForwardIterator, class T>
     ForwardIterator binary_find(ForwardIterator first, ForwardIterator last, T const &value)
     {
-        std::pair<ForwardIterator, ForwardIterator> i = std::equal_range(first, last, value);
-        return (i.first != i.second) ? i.first : last;
+        ForwardIterator i = elemel::lower_bound(first, last, value);
+        return (i != last && !(value < *i)) ? i : last;
     }
 
+    // Orderings that can compare in three ways are searched with three-way
+    // comparisons.
     template <class ForwardIterator, class T, class Compare>
     ForwardIterator binary_find(ForwardIterator first, ForwardIterator last, T const &value, Compare comp)
     {
-        std::pair<ForwardIterator, ForwardIterator> i = std::equal_range(first, last, value, comp);
-        return (i.first != i.second) ? i.first : last;
+        typedef typename detail::three_way_compare<Compare>::type
+            three_way_type;
+
+        return detail::binary_find(first, last, value, comp,
+                                   three_way_type());
+    }
+
+    // Finds each key of a batch in a sorted range, and writes an iterator to
+    // the match, or last if there is none, to out. Sorted batches are found
+    // in a single merging pass, and other batches are searched for a group
+    // at a time.
+    template <class RandomAccessIterator, class ForwardIterator,
+              class OutputIterator, class Compare>
+    OutputIterator binary_find_many(RandomAccessIterator first,
+                                    RandomAccessIterator last,
+                                    ForwardIterator keys_first,
+                                    ForwardIterator keys_last,
+                                    OutputIterator out, Compare comp)
+    {
+        if (detail::is_sorted(keys_first, keys_last, comp)) {
+            return detail::merge_find_many(first, last, keys_first, keys_last,
+                                           out, comp);
+        } else {
+            return detail::interleaved_find_many(first, last, keys_first,
+                                                 keys_last, out, comp);
+        }
+    }
+
+    template <class RandomAccessIterator, class ForwardIterator,
+              class OutputIterator>
+    OutputIterator binary_find_many(RandomAccessIterator first,
+                                    RandomAccessIterator last,
+                                    ForwardIterator keys_first,
+                                    ForwardIterator keys_last,
+                                    OutputIterator out)
+    {
+        return binary_find_many(first, last, keys_first, keys_last, out,
+                                detail::less());
     }
 }
 
@@ -0,0 +1,236 @@
+#ifndef ELEMEL_CONCURRENT_PROPERTY_MAP_HPP
+#define ELEMEL_CONCURRENT_PROPERTY_MAP_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/flat_map.hpp>
+#include <elemel/is_concurrently_readable.hpp>
+#include <elemel/detail/epoch.hpp>
+#include <elemel/detail/mutex.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+
+namespace elemel {
+    // A property map that many threads can read while others write it.
+    //
+    // The properties of a map are an immutable snapshot, together with the
+    // prototype. Readers look up keys in the snapshots along the prototype
+    // chain without locks or retries, and are wait-free. Writers are
+    // serialized by a mutex per map. They copy the snapshot, change the
+    // copy and publish it, and the old snapshot is reclaimed when no reader
+    // can see it any longer. Writes copy all the properties of a map, so
+    // they suit maps that are written rarely.
+    //
+    // Pointers returned by get_ptr() are only valid in the scope of a
+    // read_guard. get() returns a copy, and needs no guard.
+    //
+    // Readers call the const member functions of the storage while a writer
+    // copies it, so the storage must not change shared state on reads or
+    // copies, as told by is_concurrently_readable. shaped_storage does not
+    // qualify and is rejected by the static_assert below.
+    template <
+        class Key,
+        class Data,
+        class Storage = flat_map<Key, Data>
+    >
+    class concurrent_property_map {
+    public:
+        typedef Key key_type;
+        typedef Data data_type;
+        typedef Storage storage_type;
+        typedef typename storage_type::size_type size_type;
+
+        static_assert(is_concurrently_readable<storage_type>::value,
+                      "The storage must support concurrent reads and copies.");
+
+        // Keeps the values read by the calling thread in its scope alive.
+        // Guards nest.
+        class read_guard {
+        public:
+            read_guard()
+            { }
+
+        private:
+            detail::epoch_guard guard_;
+        };
+
+        explicit concurrent_property_map(
+            concurrent_property_map const *prototype = 0) :
+            snapshot_(new snapshot(prototype))
+        { }
+
+        // Readers must be done with the map.
+        ~concurrent_property_map()
+        {
+            retire(snapshot_.load(std::memory_order_relaxed));
+        }
+
+        concurrent_property_map const *prototype() const
+        {
+            read_guard guard;
+            return load()->prototype;
+        }
+
+        void prototype(concurrent_property_map const *prototype)
+        {
+            detail::lock_guard<detail::mutex> lock(mutex_);
+            snapshot *next = new snapshot(*load());
+            next->prototype = prototype;
+            publish(next);
+        }
+
+        // Must be called in the scope of a read_guard.
+        data_type const *get_ptr(key_type const &key) const
+        {
+            concurrent_property_map const *map = this;
+            do {
+                snapshot const *s = map->load();
+                typename storage_type::const_iterator i =
+                    s->properties.find(key);
+                if (i != s->properties.end()) {
+                    return &i->second;
+                }
+                map = s->prototype;
+            } while (map);
+            return 0;
+        }
+
+        // Must be called in the scope of a read_guard.
+        data_type const *get_local_ptr(key_type const &key) const
+        {
+            snapshot const *s = load();
+            typename storage_type::const_iterator i = s->properties.find(key);
+            return (i != s->properties.end()) ? &i->second : 0;
+        }
+
+        data_type get(key_type const &key) const
+        {
+            read_guard guard;
+            data_type const *result = get_ptr(key);
+            if (result == 0) {
+                throw std::out_of_range("no such key");
+            }
+            return *result;
+        }
+
+        data_type get_local(key_type const &key) const
+        {
+            read_guard guard;
+            data_type const *result = get_local_ptr(key);
+            if (result == 0) {
+                throw std::out_of_range("no such key");
+            }
+            return *result;
+        }
+
+        void set(key_type const &key, data_type const &value)
+        {
+            detail::lock_guard<detail::mutex> lock(mutex_);
+            snapshot *next = new snapshot(*load());
+            try {
+                typename storage_type::iterator i = next->properties.find(key);
+                if (i == next->properties.end()) {
+                    next->properties.insert(std::make_pair(key, value));
+                } else {
+                    i->second = value;
+                }
+            } catch (...) {
+                delete next;
+                throw;
+            }
+            publish(next);
+        }
+
+        size_type erase(key_type const &key)
+        {
+            detail::lock_guard<detail::mutex> lock(mutex_);
+            snapshot const *current = load();
+            if (current->properties.find(key) == current->properties.end()) {
+                return 0;
+            }
+            snapshot *next = new snapshot(*current);
+            try {
+                next->properties.erase(next->properties.find(key));
+            } catch (...) {
+                delete next;
+                throw;
+            }
+            publish(next);
+            return 1;
+        }
+
+        bool empty() const
+        {
+            read_guard guard;
+            return load()->properties.empty();
+        }
+
+        size_type size() const
+        {
+            read_guard guard;
+            return load()->properties.size();
+        }
+
+    private:
+        struct snapshot {
+            storage_type properties;
+            concurrent_property_map const *prototype;
+
+            explicit snapshot(concurrent_property_map const *prototype) :
+                prototype(prototype)
+            { }
+        };
+
+        std::atomic<snapshot *> snapshot_;
+        detail::mutex mutex_;
+
+        concurrent_property_map(concurrent_property_map const &other);
+        concurrent_property_map &operator=(
+            concurrent_property_map const &other);
+
+        snapshot const *load() const
+        {
+            return snapshot_.load(std::memory_order_acquire);
+        }
+
+        // Called with the mutex held.
+        void publish(snapshot *next)
+        {
+            snapshot *previous = snapshot_.load(std::memory_order_relaxed);
+            snapshot_.store(next, std::memory_order_release);
+            retire(previous);
+        }
+
+        static void retire(snapshot *s)
+        {
+            detail::epoch_domain::instance().retire(s, &destroy);
+        }
+
+        static void destroy(void *s)
+        {
+            delete static_cast<snapshot *>(s);
+        }
+    };
+}
+
+#endif // ELEMEL_CONCURRENT_PROPERTY_MAP_HPP
@@ -1,13 +1,19 @@
 #ifndef ELEMEL_CONST_STRING_HPP
 #define ELEMEL_CONST_STRING_HPP
 
+#include <elemel/hash_string.hpp>
+#include <elemel/is_trivially_relocatable.hpp>
 #include <elemel/raw_allocator.hpp>
 #include <elemel/ref_ptr.hpp>
 #include <elemel/string_range.hpp>
+#include <elemel/detail/string_compare.hpp>
 #include <elemel/detail/string_impl.hpp>
+#include <elemel/detail/type_traits.hpp>
 
 #include <cassert>
+#include <functional>
 #include <string>
+#include <tr1/functional>
 
 namespace elemel {
     enum by_ref_tag { by_ref };
@@ -93,17 +99,94 @@ namespace elemel {
             return range_.end();
         }
 
+        // Returns a negative number, zero or a positive number if this
+        // string is ordered before, with or after the other string.
+        int compare(basic_const_string const &other) const
+        {
+            return detail::string_compare<traits_type>::compare(
+                begin(), end(), other.begin(), other.end());
+        }
+
+        int compare(const_pointer str) const
+        {
+            assert(str);
+            return detail::string_compare<traits_type>::compare_terminated(
+                begin(), end(), str);
+        }
+
+        // The hash of the characters, as computed by hash_string(). Strings
+        // that own their characters compute it once, when they are created.
+        std::size_t hash() const
+        {
+            return impl_ ? impl_->hash() : hash_string(begin(), end());
+        }
+
+        // Tells if hash() takes constant time. Strings by reference hash
+        // their characters on each call.
+        bool hash_cached() const
+        {
+            return impl_.get() != 0;
+        }
+
+        // Tells if the string was returned by intern(). Equal interned
+        // strings share their characters.
+        bool interned() const
+        {
+            return impl_ && impl_->interned();
+        }
+
+        // Must be called before the string is handed to another thread, if
+        // the reference count is a deferred_ref_count. Strings by reference
+        // have no count.
+        void share() const
+        {
+            if (impl_) {
+                impl_->share();
+            }
+        }
+
+        void swap(basic_const_string &other)
+        {
+            impl_.swap(other.impl_);
+            std::swap(range_, other.range_);
+        }
+
     private:
+        template <class String>
+        friend String basic_intern(typename String::range_type const &range);
+
         ref_ptr<impl_type> impl_;
         range_type range_;
+
+        explicit basic_const_string(impl_type *impl) :
+            impl_(impl),
+            range_(impl_->data(), impl_->data() + impl_->size())
+        { }
     };
 
     template <class C, class T, class N, class A>
     bool operator==(basic_const_string<C, T, N, A> const &left,
                     basic_const_string<C, T, N, A> const &right)
     {
-        return (left.size() == right.size() &&
-                std::equal(left.begin(), left.end(), right.begin(), T::eq));
+        if (left.data() == right.data()) {
+            return left.size() == right.size();
+        }
+        if (left.size() != right.size()) {
+            return false;
+        }
+
+        // Equal interned strings share their characters only if the traits
+        // compare characters exactly. Otherwise, as with case-insensitive
+        // traits, they are interned separately.
+        if (detail::is_exact_char_traits<T>::value &&
+            ((left.interned() && right.interned()) ||
+             (left.hash_cached() && right.hash_cached() &&
+              left.hash() != right.hash())))
+        {
+            return false;
+        }
+        return detail::string_compare<T>::equal(left.begin(), left.end(),
+                                                right.begin(), right.end());
     }
 
     template <class C, class T, class N, class A>
@@ -117,8 +200,7 @@ namespace elemel {
     bool operator<(basic_const_string<C, T, N, A> const &left,
                    basic_const_string<C, T, N, A> const &right)
     {
-        return std::lexicographical_compare(left.begin(), left.end(),
-                                            right.begin(), right.end(), T::lt);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T, class N, class A>
@@ -146,8 +228,8 @@ namespace elemel {
     bool operator==(basic_const_string<C, T, N, A> const &left, C const *right)
     {
         assert(right);
-        std::size_t n = T::length(right);
-        return left.size() == n && std::equal(left.begin(), left.end(), right);
+        return detail::string_compare<T>::equal_terminated(left.begin(),
+                                                           left.end(), right);
     }
 
     template <class C, class T, class N, class A>
@@ -159,10 +241,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator<(basic_const_string<C, T, N, A> const &left, C const *right)
     {
-        assert(right);
-        return std::lexicographical_compare(left.begin(), left.end(),
-                                            right, right + T::length(right),
-                                            T::lt);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T, class N, class A>
@@ -186,9 +265,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator==(C const *left, basic_const_string<C, T, N, A> const &right)
     {
-        assert(left);
-        std::size_t n = T::length(left);
-        return n == right.size() && std::equal(left, left + n, right.begin());
+        return right == left;
     }
 
     template <class C, class T, class N, class A>
@@ -200,10 +277,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator<(C const *left, basic_const_string<C, T, N, A> const &right)
     {
-        assert(left);
-        return std::lexicographical_compare(left, left + T::length(left),
-                                            right.begin(), right.end(),
-                                            T::lt);
+        return right.compare(left) > 0;
     }
 
     template <class C, class T, class N, class A>
@@ -224,8 +298,54 @@ namespace elemel {
         return right < left;
     }
 
+    namespace detail {
+        template <class C, class T, class N, class A>
+        struct three_way_compare<std::less<basic_const_string<C, T, N, A> > > :
+            true_type
+        {
+            typedef basic_const_string<C, T, N, A> string_type;
+
+            static int compare(std::less<string_type> const &comp,
+                               string_type const &left,
+                               string_type const &right)
+            {
+                return left.compare(right);
+            }
+        };
+    }
+
+    // Found by argument-dependent lookup, so that algorithms swap strings
+    // without touching their reference counts.
+    template <class C, class T, class N, class A>
+    void swap(basic_const_string<C, T, N, A> &first,
+              basic_const_string<C, T, N, A> &second)
+    {
+        first.swap(second);
+    }
+
+    template <class C, class T, class N, class A>
+    struct is_trivially_relocatable<basic_const_string<C, T, N, A> > :
+        detail::true_type
+    { };
+
     typedef basic_const_string<char> const_string;
     typedef basic_const_string<wchar_t> const_wstring;
 }
 
+namespace std {
+    namespace tr1 {
+        // Hashes the characters with hash_string().
+        template <class C, class T, class N, class A>
+        struct hash<elemel::basic_const_string<C, T, N, A> > {
+            typedef elemel::basic_const_string<C, T, N, A> argument_type;
+            typedef size_t result_type;
+
+            size_t operator()(argument_type const &arg) const
+            {
+                return arg.hash();
+            }
+        };
+    }
+}
+
 #endif // ELEMEL_CONST_STRING_HPP
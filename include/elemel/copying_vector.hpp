@@ -21,12 +21,26 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/inline_storage.hpp>
+#include <elemel/detail/relocate.hpp>
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 
+#if !defined(ELEMEL_NO_CXX11)
+#include <type_traits>
+#endif
+
 namespace elemel {
-    template <class T, class Allocator = std::allocator<T> >
+    // Stores up to N values inline, without allocating. Larger vectors move
+    // to allocated storage, and stay there.
+    template <class T, class Allocator = std::allocator<T>, std::size_t N = 0>
     class copying_vector {
     public:
         typedef T value_type;
@@ -48,7 +62,9 @@ namespace elemel {
             end_(0),
             capacity_(0),
             allocator_(allocator)
-        { }
+        {
+            reset_storage();
+        }
 
         explicit copying_vector(size_type n,
                                 value_type const &value = value_type(),
@@ -58,9 +74,14 @@ namespace elemel {
             capacity_(0),
             allocator_(allocator)
         {
-            copying_vector temp(allocator_);
-            temp.resize(n, value);
-            swap(temp);
+            reset_storage();
+            try {
+                resize(n, value);
+            } catch (...) {
+                clear();
+                release_storage();
+                throw;
+            }
         }
 
         copying_vector(copying_vector const &other) :
@@ -69,33 +90,69 @@ namespace elemel {
             capacity_(0),
             allocator_(other.allocator_)
         {
-            copying_vector temp(allocator_);
-            temp.reserve(other.size());
-            temp.insert(temp.end_, other.begin_, other.end_);
-            swap(temp);
+            reset_storage();
+            try {
+                reserve(other.size());
+                insert(end_, other.begin_, other.end_);
+            } catch (...) {
+                clear();
+                release_storage();
+                throw;
+            }
         }
 
+#if !defined(ELEMEL_NO_CXX11)
+        // Exception safety: No-throw guarantee if the values are in
+        // allocated storage, or if they can be moved without throwing.
+        copying_vector(copying_vector &&other)
+            noexcept(N == 0 || std::is_nothrow_move_constructible<T>::value) :
+            begin_(0),
+            end_(0),
+            capacity_(0),
+            allocator_(std::move(other.allocator_))
+        {
+            reset_storage();
+            take(other);
+        }
+#endif
+
         // Exception safety: No-throw guarantee.
         ~copying_vector()
         {
-            if (begin_) {
-                clear();
-                allocator_.deallocate(begin_, capacity());
-            }
+            clear();
+            release_storage();
         }
 
         // Exception safety: Basic guarantee.
         copying_vector &operator=(copying_vector const &other)
         {
-            if (capacity() < other.size()) {
-                copying_vector temp(other);
-                swap(temp);
-            } else {
+            if (this != &other) {
                 clear();
+                reserve(other.size());
                 insert(end_, other.begin_, other.end_);
             }
+            return *this;
         }
 
+#if !defined(ELEMEL_NO_CXX11)
+        // Exception safety: No-throw guarantee if the values are in
+        // allocated storage, or if they can be moved without throwing.
+        copying_vector &operator=(copying_vector &&other)
+            noexcept(N == 0 || std::is_nothrow_move_constructible<T>::value)
+        {
+            if (this != &other) {
+                clear();
+                if (other.is_allocated()) {
+                    release_storage();
+                    reset_storage();
+                    allocator_ = std::move(other.allocator_);
+                }
+                take(other);
+            }
+            return *this;
+        }
+#endif
+
         // Exception safety: No-throw guarantee.
         iterator begin()
         {
@@ -160,7 +217,13 @@ namespace elemel {
         void resize(size_type n, value_type const &value)
         {
             if (size() < n) {
-                reserve(n);
+                if (capacity() < n) {
+                    // The value may be in the storage that is replaced.
+                    value_type temp(value);
+                    reserve(n);
+                    resize(n, temp);
+                    return;
+                }
                 do {
                     allocator_.construct(end_, value);
                     ++end_;
@@ -189,10 +252,7 @@ namespace elemel {
         {
             if (capacity() < n) {
                 if (begin_) {
-                    copying_vector temp(allocator_);
-                    temp.reserve(n);
-                    temp.insert(temp.end_, begin_, end_);
-                    swap(temp);
+                    grow(n, can_reallocate_type());
                 } else {
                     begin_ = end_ = allocator_.allocate(n, 0);
                     capacity_ = begin_ + n;
@@ -200,13 +260,73 @@ namespace elemel {
             }
         }
 
+#if defined(ELEMEL_NO_CXX11)
         // Exception safety: Strong guarantee.
         void push_back(value_type const &value)
         {
-            auto_reserve(size() + 1);
-            allocator_.construct(end_, value);
-            ++end_;
+            if (end_ != capacity_) {
+                allocator_.construct(end_, value);
+                ++end_;
+            } else if (can_reallocate_type::value) {
+                // The value may be in the storage that is reallocated.
+                value_type temp(value);
+                auto_reserve(size() + 1);
+                allocator_.construct(end_, temp);
+                ++end_;
+            } else {
+                size_type n = size();
+                size_type m = grow_capacity(n + 1);
+                iterator p = allocator_.allocate(m, 0);
+                try {
+                    allocator_.construct(p + n, value);
+                } catch (...) {
+                    allocator_.deallocate(p, m);
+                    throw;
+                }
+                relocate_to(p, n, 1, m);
+            }
+        }
+#else
+        // Exception safety: Strong guarantee.
+        void push_back(value_type const &value)
+        {
+            emplace_back(value);
+        }
+
+        // Exception safety: Strong guarantee.
+        void push_back(value_type &&value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        // Exception safety: Strong guarantee.
+        template <class... Args>
+        void emplace_back(Args &&... args)
+        {
+            if (end_ != capacity_) {
+                allocator_.construct(end_, std::forward<Args>(args)...);
+                ++end_;
+            } else if (can_reallocate_type::value) {
+                // The arguments may refer to the storage that is
+                // reallocated.
+                value_type temp(std::forward<Args>(args)...);
+                auto_reserve(size() + 1);
+                allocator_.construct(end_, std::move(temp));
+                ++end_;
+            } else {
+                size_type n = size();
+                size_type m = grow_capacity(n + 1);
+                iterator p = allocator_.allocate(m, 0);
+                try {
+                    allocator_.construct(p + n, std::forward<Args>(args)...);
+                } catch (...) {
+                    allocator_.deallocate(p, m);
+                    throw;
+                }
+                relocate_to(p, n, 1, m);
+            }
         }
+#endif
 
         // Exception safety: No-throw guarantee.
         void pop_back()
@@ -281,68 +401,148 @@ namespace elemel {
             return *(begin_ + index);
         }
 
+#if defined(ELEMEL_NO_CXX11)
         // Exception safety: Basic guarantee.
         iterator insert(iterator position, value_type const &value)
         {
             if (position == end_) {
                 push_back(value);
                 return end_ - 1;
-            } else if (size() == capacity()) {
-                copying_vector temp(allocator_);
-                temp.auto_reserve(size() + 1);
-                temp.insert(temp.end_, begin_, position);
-                temp.push_back(value);
-                temp.insert(temp.end_, position, end_);
-                swap(temp);
-                return begin_ + (position - temp.begin_);
+            }
+            size_type index = position - begin_;
+            if (end_ != capacity_ || can_reallocate_type::value) {
+                // The value may be one of the values that are shifted.
+                value_type temp(value);
+                auto_reserve(size() + 1);
+                shift_insert(begin_ + index, temp);
             } else {
-                iterator j = end_;
+                size_type n = size();
+                size_type m = grow_capacity(n + 1);
+                iterator p = allocator_.allocate(m, 0);
                 try {
-                    do {
-                        allocator_.construct(j, *(j - 1));
-                        allocator_.destroy(--j);
-                    } while (j != position);
-                    allocator_.construct(position, value);
+                    allocator_.construct(p + index, value);
                 } catch (...) {
-                    while (end_ != j) {
-                        allocator_.destroy(end_);
-                        --end_;
-                    }
+                    allocator_.deallocate(p, m);
                     throw;
                 }
-                ++end_;
-                return position;
+                relocate_to(p, index, 1, m);
             }
+            return begin_ + index;
+        }
+#else
+        // Exception safety: Basic guarantee.
+        iterator insert(iterator position, value_type const &value)
+        {
+            return emplace(position, value);
+        }
+
+        // Exception safety: Basic guarantee.
+        iterator insert(iterator position, value_type &&value)
+        {
+            return emplace(position, std::move(value));
         }
 
         // Exception safety: Basic guarantee.
+        template <class... Args>
+        iterator emplace(iterator position, Args &&... args)
+        {
+            if (position == end_) {
+                emplace_back(std::forward<Args>(args)...);
+                return end_ - 1;
+            }
+            size_type index = position - begin_;
+            if (end_ != capacity_ || can_reallocate_type::value) {
+                // The arguments may refer to the values that are shifted.
+                value_type temp(std::forward<Args>(args)...);
+                auto_reserve(size() + 1);
+                shift_insert(begin_ + index, temp);
+            } else {
+                size_type n = size();
+                size_type m = grow_capacity(n + 1);
+                iterator p = allocator_.allocate(m, 0);
+                try {
+                    allocator_.construct(p + index,
+                                         std::forward<Args>(args)...);
+                } catch (...) {
+                    allocator_.deallocate(p, m);
+                    throw;
+                }
+                relocate_to(p, index, 1, m);
+            }
+            return begin_ + index;
+        }
+#endif
+
+        // Exception safety: Strong guarantee for trivially relocatable
+        // values, or when inserting at the end. Basic guarantee otherwise.
         template <class InputIterator>
         void insert(iterator position, InputIterator first, InputIterator last)
         {
-            difference_type diff = std::distance(first, last);
-            if (size() + diff > capacity()) {
-                copying_vector temp(allocator_);
-                temp.auto_reserve(size() + diff);
-                temp.insert(temp.end_, begin_, position);
-                temp.insert(temp.end_, first, last);
-                temp.insert(temp.end_, position, end_);
-                swap(temp);
-            } else if (position == end_) {
-                for (iterator i = first; i != last; ++i) {
-                    allocator_.construct(end_, *i);
-                    ++end_;
-                }
-            } else {
-                assert(false);
+            typedef typename std::iterator_traits<InputIterator>::iterator_category
+                iterator_category;
+
+            insert(position, first, last, iterator_category());
+        }
+
+        // Exception safety: No-throw guarantee if the values can be assigned
+        // without throwing. Basic guarantee otherwise.
+        iterator erase(iterator position)
+        {
+            assert(position != end_);
+            return erase(position, position + 1);
+        }
+
+        // Exception safety: No-throw guarantee if the values can be assigned
+        // without throwing. Basic guarantee otherwise.
+        iterator erase(iterator first, iterator last)
+        {
+            assert(begin_ <= first && first <= last && last <= end_);
+            if (first != last) {
+                erase(first, last, is_trivially_relocatable_type());
             }
-        };
+            return first;
+        }
 
-        // Exception safety: No-throw guarantee.
+        // Exception safety: No-throw guarantee if the values of both vectors
+        // are in allocated storage. Strong guarantee if the values of one
+        // vector are inline. Basic guarantee if both are.
         void swap(copying_vector &other)
         {
-            std::swap(begin_, other.begin_);
-            std::swap(end_, other.end_);
-            std::swap(capacity_, other.capacity_);
+            if (N == 0 || (is_allocated() && other.is_allocated())) {
+                std::swap(begin_, other.begin_);
+                std::swap(end_, other.end_);
+                std::swap(capacity_, other.capacity_);
+            } else if (is_allocated()) {
+                other.swap(*this);
+                return;
+            } else if (other.is_allocated()) {
+                // Move the inline values over, and take the storage.
+                iterator p = other.storage_.data();
+                iterator q = detail::relocate_construct(allocator_, begin_,
+                                                        end_, p);
+                detail::relocate_destroy(allocator_, begin_, end_);
+                begin_ = other.begin_;
+                end_ = other.end_;
+                capacity_ = other.capacity_;
+                other.begin_ = p;
+                other.end_ = q;
+                other.capacity_ = p + N;
+            } else {
+                // Swap the common prefix, and move the rest over.
+                copying_vector *shorter = this;
+                copying_vector *longer = &other;
+                if (shorter->size() > longer->size()) {
+                    std::swap(shorter, longer);
+                }
+                iterator middle = std::swap_ranges(shorter->begin_,
+                                                   shorter->end_,
+                                                   longer->begin_);
+                shorter->end_ = detail::relocate_construct(allocator_, middle,
+                                                           longer->end_,
+                                                           shorter->end_);
+                detail::relocate_destroy(allocator_, middle, longer->end_);
+                longer->end_ = middle;
+            }
             std::swap(allocator_, other.allocator_);
         }
 
@@ -353,29 +553,353 @@ namespace elemel {
         }
 
     private:
+        typedef typename is_trivially_relocatable<value_type>::type
+            is_trivially_relocatable_type;
+        typedef detail::bool_constant<
+            is_trivially_relocatable<value_type>::value &&
+            detail::has_reallocate<allocator_type>::value
+        > can_reallocate_type;
+
         value_type *begin_;
         value_type *end_;
         value_type *capacity_;
         allocator_type allocator_;
+        detail::inline_storage<value_type, N> storage_;
+
+        // Tells if the values are in storage from the allocator, rather than
+        // inline or nowhere.
+        bool is_allocated() const
+        {
+            return begin_ != storage_.data();
+        }
+
+        // Exception safety: No-throw guarantee.
+        void release_storage()
+        {
+            if (is_allocated()) {
+                allocator_.deallocate(begin_, capacity());
+            }
+        }
+
+        // Goes back to the inline storage, without releasing the current
+        // storage.
+        //
+        // Exception safety: No-throw guarantee.
+        void reset_storage()
+        {
+            begin_ = end_ = storage_.data();
+            capacity_ = begin_ + N;
+        }
+
+        // Takes the values of other, which may be inline, into this vector,
+        // which must be empty. Allocated storage is taken over as a whole;
+        // this vector must not hold allocated storage of its own then.
+        //
+        // Exception safety: No-throw guarantee if the values are in
+        // allocated storage, or if they can be moved without throwing.
+        void take(copying_vector &other)
+        {
+            assert(empty());
+            if (other.is_allocated()) {
+                assert(!is_allocated());
+                begin_ = other.begin_;
+                end_ = other.end_;
+                capacity_ = other.capacity_;
+                other.reset_storage();
+            } else {
+                end_ = detail::relocate_construct(allocator_, other.begin_,
+                                                  other.end_, begin_);
+                detail::relocate_destroy(allocator_, other.begin_,
+                                         other.end_);
+                other.end_ = other.begin_;
+            }
+        }
 
         void auto_reserve(size_type n)
+        {
+            if (capacity() < n) {
+                reserve(grow_capacity(n));
+            }
+        }
+
+        size_type grow_capacity(size_type n) const
         {
             size_type m = capacity();
-            if (m < n) {
-                do {
-                    // Grow by Golden Ratio.
-                    m = m * 233 / 144 + 1;
-                } while (m < n);
-                reserve(m);
+            do {
+                // Grow by Golden Ratio.
+                m = m * 233 / 144 + 1;
+            } while (m < n);
+            return m;
+        }
+
+        // Takes over new storage p with capacity m, in which n new values
+        // have already been constructed at index. Moves the old values around
+        // them, and frees the old storage. If the move fails, frees the new
+        // storage and the new values instead.
+        //
+        // Exception safety: Strong guarantee.
+        void relocate_to(iterator p, size_type index, size_type n,
+                         size_type m)
+        {
+            iterator position = begin_ + index;
+            try {
+                detail::relocate_construct(allocator_, begin_, position, p);
+                try {
+                    detail::relocate_construct(allocator_, position, end_,
+                                               p + index + n);
+                } catch (...) {
+                    detail::destroy(allocator_, p, p + index);
+                    throw;
+                }
+            } catch (...) {
+                detail::destroy(allocator_, p + index, p + index + n);
+                allocator_.deallocate(p, m);
+                throw;
+            }
+            detail::relocate_destroy(allocator_, begin_, end_);
+            replace_storage(p, size() + n, m);
+        }
+
+        // Exception safety: No-throw guarantee.
+        void replace_storage(iterator p, size_type n, size_type m)
+        {
+            release_storage();
+            begin_ = p;
+            end_ = p + n;
+            capacity_ = p + m;
+        }
+
+        // Grows the storage in place, or moves the bytes, with the
+        // allocator's reallocate().
+        //
+        // Exception safety: Strong guarantee.
+        void grow(size_type n, detail::true_type)
+        {
+            if (!is_allocated()) {
+                // Inline storage cannot be reallocated.
+                grow(n, detail::false_type());
+                return;
+            }
+            size_type old_size = size();
+            begin_ = allocator_.reallocate(begin_, capacity(), n);
+            end_ = begin_ + old_size;
+            capacity_ = begin_ + n;
+        }
+
+        // Exception safety: Strong guarantee.
+        void grow(size_type n, detail::false_type)
+        {
+            iterator p = allocator_.allocate(n, 0);
+            try {
+                detail::relocate_construct(allocator_, begin_, end_, p);
+            } catch (...) {
+                allocator_.deallocate(p, n);
+                throw;
+            }
+            detail::relocate_destroy(allocator_, begin_, end_);
+            replace_storage(p, size(), n);
+        }
+
+        template <class InputIterator>
+        void insert(iterator position, InputIterator first,
+                    InputIterator last, std::input_iterator_tag)
+        {
+            // Count the values by collecting them first.
+            copying_vector temp(allocator_);
+            for (; first != last; ++first) {
+                temp.push_back(*first);
+            }
+            insert(position, temp.begin_, temp.end_,
+                   std::random_access_iterator_tag());
+        }
+
+        template <class ForwardIterator>
+        void insert(iterator position, ForwardIterator first,
+                    ForwardIterator last, std::forward_iterator_tag)
+        {
+            size_type n = std::distance(first, last);
+            if (n == 0) {
+                return;
+            }
+            size_type index = position - begin_;
+            if (size() + n <= capacity() || can_reallocate_type::value) {
+                auto_reserve(size() + n);
+                position = begin_ + index;
+                if (position == end_) {
+                    append(first, last);
+                } else {
+                    shift_insert(position, first, last, n,
+                                 is_trivially_relocatable_type());
+                }
+            } else {
+                size_type m = grow_capacity(size() + n);
+                iterator p = allocator_.allocate(m, 0);
+                try {
+                    construct(p + index, first, last);
+                } catch (...) {
+                    allocator_.deallocate(p, m);
+                    throw;
+                }
+                relocate_to(p, index, n, m);
+            }
+        }
+
+        // Constructs copies of the values in uninitialized storage at p.
+        //
+        // Exception safety: Strong guarantee.
+        template <class ForwardIterator>
+        void construct(iterator p, ForwardIterator first,
+                       ForwardIterator last)
+        {
+            iterator i = p;
+            try {
+                for (; first != last; ++first, ++i) {
+                    allocator_.construct(i, *first);
+                }
+            } catch (...) {
+                detail::destroy(allocator_, p, i);
+                throw;
+            }
+        }
+
+        // Exception safety: Strong guarantee.
+        template <class ForwardIterator>
+        void append(ForwardIterator first, ForwardIterator last)
+        {
+            assert(size() + std::distance(first, last) <= capacity());
+            construct(end_, first, last);
+            end_ += std::distance(first, last);
+        }
+
+        // Opens a gap of n values with a single move of the bytes, and
+        // constructs the new values in it.
+        //
+        // Exception safety: Strong guarantee.
+        template <class ForwardIterator>
+        void shift_insert(iterator position, ForwardIterator first,
+                          ForwardIterator last, size_type n,
+                          detail::true_type)
+        {
+            size_type tail = (end_ - position) * sizeof(value_type);
+            std::memmove(static_cast<void *>(position + n),
+                         static_cast<void const *>(position), tail);
+            try {
+                construct(position, first, last);
+            } catch (...) {
+                std::memmove(static_cast<void *>(position),
+                             static_cast<void const *>(position + n), tail);
+                throw;
+            }
+            end_ += n;
+        }
+
+        // Moves the last values of the tail to uninitialized storage, shifts
+        // the rest of the tail in one pass, and assigns the new values.
+        //
+        // Exception safety: Basic guarantee.
+        template <class ForwardIterator>
+        void shift_insert(iterator position, ForwardIterator first,
+                          ForwardIterator last, size_type n,
+                          detail::false_type)
+        {
+            iterator old_end = end_;
+            size_type tail = end_ - position;
+            if (tail > n) {
+                end_ = detail::relocate_construct(allocator_, end_ - n, end_,
+                                                  end_);
+#if defined(ELEMEL_NO_CXX11)
+                std::copy_backward(position, old_end - n, old_end);
+#else
+                std::move_backward(position, old_end - n, old_end);
+#endif
+                std::copy(first, last, position);
+            } else {
+                ForwardIterator middle = first;
+                std::advance(middle, tail);
+                append(middle, last);
+                end_ = detail::relocate_construct(allocator_, position,
+                                                  old_end, end_);
+                std::copy(first, middle, position);
+            }
+        }
+
+        // Closes the gap with a single move of the bytes.
+        //
+        // Exception safety: No-throw guarantee.
+        void erase(iterator first, iterator last, detail::true_type)
+        {
+            detail::destroy(allocator_, first, last);
+            std::memmove(static_cast<void *>(first),
+                         static_cast<void const *>(last),
+                         (end_ - last) * sizeof(value_type));
+            end_ -= last - first;
+        }
+
+        // Exception safety: No-throw guarantee if the values can be assigned
+        // without throwing. Basic guarantee otherwise.
+        void erase(iterator first, iterator last, detail::false_type)
+        {
+#if defined(ELEMEL_NO_CXX11)
+            iterator new_end = std::copy(last, end_, first);
+#else
+            iterator new_end = std::move(last, end_, first);
+#endif
+            detail::destroy(allocator_, new_end, end_);
+            end_ = new_end;
+        }
+
+        // Shifts the values from position one step towards the end, and
+        // moves temp into the gap. There must be room for one more value.
+        //
+        // Exception safety: Basic guarantee.
+        void shift_insert(iterator position, value_type &temp)
+        {
+            assert(end_ != capacity_);
+            shift_insert(position, temp, is_trivially_relocatable_type());
+        }
+
+        // Exception safety: Strong guarantee.
+        void shift_insert(iterator position, value_type &temp,
+                          detail::true_type)
+        {
+            size_type n = (end_ - position) * sizeof(value_type);
+            std::memmove(static_cast<void *>(position + 1),
+                         static_cast<void const *>(position), n);
+            try {
+                allocator_.construct(position, ELEMEL_MOVE(temp));
+            } catch (...) {
+                std::memmove(static_cast<void *>(position),
+                             static_cast<void const *>(position + 1), n);
+                throw;
+            }
+            ++end_;
+        }
+
+        // Exception safety: Basic guarantee.
+        void shift_insert(iterator position, value_type &temp,
+                          detail::false_type)
+        {
+            if (position == end_) {
+                allocator_.construct(end_, ELEMEL_MOVE(temp));
+                ++end_;
+            } else {
+                allocator_.construct(end_, ELEMEL_MOVE(*(end_ - 1)));
+                ++end_;
+#if defined(ELEMEL_NO_CXX11)
+                std::copy_backward(position, end_ - 2, end_ - 1);
+#else
+                std::move_backward(position, end_ - 2, end_ - 1);
+#endif
+                *position = ELEMEL_MOVE(temp);
             }
         }
     };
 }
 
 namespace std {
-    template <class T, class Allocator>
-    void swap(elemel::copying_vector<T, Allocator> &first,
-              elemel::copying_vector<T, Allocator> &second)
+    template <class T, class Allocator, std::size_t N>
+    void swap(elemel::copying_vector<T, Allocator, N> &first,
+              elemel::copying_vector<T, Allocator, N> &second)
     {
         first.swap(second);
     }
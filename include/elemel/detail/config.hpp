@@ -0,0 +1,62 @@
+#ifndef ELEMEL_CONFIG_HPP
+#define ELEMEL_CONFIG_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#if __cplusplus < 201103L
+#   define ELEMEL_NO_CXX11
+#endif
+
+#if defined(ELEMEL_NO_CXX11)
+#   define ELEMEL_MOVE(x) (x)
+#   define ELEMEL_MOVE_IF_NOEXCEPT(x) (x)
+#else
+#   include <utility>
+#   define ELEMEL_MOVE(x) std::move(x)
+#   define ELEMEL_MOVE_IF_NOEXCEPT(x) std::move_if_noexcept(x)
+#endif
+
+// Cache line size assumed by layouts and prefetching.
+#define ELEMEL_CACHE_LINE_SIZE 64
+
+#if defined(__GNUC__)
+#   define ELEMEL_PREFETCH(p) __builtin_prefetch(p)
+#else
+#   define ELEMEL_PREFETCH(p) ((void) 0)
+#endif
+
+// Keeps rarely taken paths out of their callers.
+#if defined(__GNUC__)
+#   define ELEMEL_NOINLINE __attribute__((noinline))
+#else
+#   define ELEMEL_NOINLINE
+#endif
+
+// Kernels that read whole aligned blocks past the end of a terminated string
+// are not instrumented by AddressSanitizer.
+#if defined(__clang__) || (defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)))
+#   define ELEMEL_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#   define ELEMEL_NO_SANITIZE_ADDRESS
+#endif
+
+#endif // ELEMEL_CONFIG_HPP
@@ -0,0 +1,246 @@
+#ifndef ELEMEL_EPOCH_HPP
+#define ELEMEL_EPOCH_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/mutex.hpp>
+
+#if defined(ELEMEL_NO_CXX11)
+#error "Epoch reclamation needs C++11."
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Epoch-based reclamation. Readers announce the global epoch while they
+// read shared objects, and writers retire the objects that they unlink. A
+// retired object is destroyed once the epoch has advanced twice, since every
+// reader that could have seen it has left by then. The epoch only advances
+// when all readers have announced the current one.
+
+namespace elemel {
+    namespace detail {
+        // The announcement of one thread. The epoch is stored shifted left
+        // by one, with the low bit set while the thread reads.
+        struct epoch_record {
+            std::atomic<unsigned long> epoch;
+            std::atomic<bool> used;
+            epoch_record *next;
+            std::size_t depth;
+        };
+
+        class epoch_domain {
+        public:
+            // The domain is never destroyed, so that retired objects can be
+            // reclaimed during static destruction.
+            static epoch_domain &instance()
+            {
+                static epoch_domain *domain = new epoch_domain;
+                return *domain;
+            }
+
+            // Takes a record that is not used by another thread, or adds a
+            // new one. Records are never freed.
+            epoch_record *acquire()
+            {
+                for (epoch_record *record = records_.load(); record;
+                     record = record->next)
+                {
+                    bool used = false;
+                    if (!record->used.load(std::memory_order_relaxed) &&
+                        record->used.compare_exchange_strong(used, true))
+                    {
+                        return record;
+                    }
+                }
+
+                epoch_record *record = new epoch_record;
+                record->epoch.store(0, std::memory_order_relaxed);
+                record->used.store(true, std::memory_order_relaxed);
+                record->depth = 0;
+                record->next = records_.load();
+                while (!records_.compare_exchange_weak(record->next, record))
+                { }
+                return record;
+            }
+
+            void release(epoch_record *record)
+            {
+                record->used.store(false, std::memory_order_release);
+            }
+
+            // Wait-free.
+            void enter(epoch_record *record)
+            {
+                if (record->depth++ == 0) {
+                    unsigned long epoch = epoch_.load();
+                    record->epoch.store(epoch << 1 | 1,
+                                        std::memory_order_relaxed);
+
+                    // Orders the announcement before the reads, against the
+                    // fence in advance().
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+            }
+
+            void leave(epoch_record *record)
+            {
+                if (--record->depth == 0) {
+                    record->epoch.store(0, std::memory_order_release);
+                }
+            }
+
+            // Destroys the object with destroy() once no reader can see
+            // it. The object must already be unreachable for new readers.
+            void retire(void *object, void (*destroy)(void *))
+            {
+                retired r = { object, destroy, 0 };
+                {
+                    lock_guard<mutex> lock(mutex_);
+                    r.epoch = epoch_.load();
+                    retired_.push_back(r);
+                }
+                collect();
+            }
+
+            // Advances the epoch as far as the readers allow, and destroys
+            // the objects that are old enough.
+            void collect()
+            {
+                std::vector<retired> expired;
+                {
+                    lock_guard<mutex> lock(mutex_);
+                    if (retired_.empty()) {
+                        return;
+                    }
+                    unsigned long epoch = epoch_.load();
+                    for (int i = 0; i != 2 && advance(epoch); ++i) {
+                        ++epoch;
+                    }
+                    std::size_t kept = 0;
+                    for (std::size_t i = 0; i != retired_.size(); ++i) {
+                        if (retired_[i].epoch + 2 <= epoch) {
+                            expired.push_back(retired_[i]);
+                        } else {
+                            retired_[kept++] = retired_[i];
+                        }
+                    }
+                    retired_.resize(kept);
+                }
+                for (std::size_t i = 0; i != expired.size(); ++i) {
+                    expired[i].destroy(expired[i].object);
+                }
+            }
+
+        private:
+            struct retired {
+                void *object;
+                void (*destroy)(void *);
+                unsigned long epoch;
+            };
+
+            std::atomic<unsigned long> epoch_;
+            std::atomic<epoch_record *> records_;
+            mutex mutex_;
+            std::vector<retired> retired_;
+
+            epoch_domain() :
+                epoch_(0),
+                records_(0)
+            { }
+
+            epoch_domain(epoch_domain const &other);
+            epoch_domain &operator=(epoch_domain const &other);
+
+            // Called with the mutex held.
+            bool advance(unsigned long epoch)
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                for (epoch_record *record = records_.load(); record;
+                     record = record->next)
+                {
+                    unsigned long announced = record->epoch.load();
+                    if ((announced & 1) && (announced >> 1) != epoch) {
+                        return false;
+                    }
+                }
+                epoch_.store(epoch + 1);
+                return true;
+            }
+        };
+
+        // Releases the record of a thread when the thread exits.
+        class epoch_thread {
+        public:
+            epoch_thread() :
+                record_(epoch_domain::instance().acquire())
+            { }
+
+            ~epoch_thread()
+            {
+                epoch_domain::instance().release(record_);
+            }
+
+            epoch_record *record() const
+            {
+                return record_;
+            }
+
+        private:
+            epoch_record *record_;
+
+            epoch_thread(epoch_thread const &other);
+            epoch_thread &operator=(epoch_thread const &other);
+        };
+
+        inline epoch_record *thread_epoch_record()
+        {
+            static thread_local epoch_thread thread;
+            return thread.record();
+        }
+
+        // Keeps the objects that the calling thread reads in its scope from
+        // being destroyed. Guards nest.
+        class epoch_guard {
+        public:
+            epoch_guard() :
+                record_(thread_epoch_record())
+            {
+                epoch_domain::instance().enter(record_);
+            }
+
+            ~epoch_guard()
+            {
+                epoch_domain::instance().leave(record_);
+            }
+
+        private:
+            epoch_record *record_;
+
+            epoch_guard(epoch_guard const &other);
+            epoch_guard &operator=(epoch_guard const &other);
+        };
+    }
+}
+
+#endif // ELEMEL_EPOCH_HPP
@@ -0,0 +1,75 @@
+#ifndef ELEMEL_INLINE_STORAGE_HPP
+#define ELEMEL_INLINE_STORAGE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+
+#include <cstddef>
+
+namespace elemel {
+    namespace detail {
+        // Uninitialized, suitably aligned storage for n values of type T.
+        // Constructing and destroying the values is up to the owner.
+        template <class T, std::size_t N>
+        class inline_storage {
+        public:
+            T *data()
+            {
+                return reinterpret_cast<T *>(&buffer_);
+            }
+
+            T const *data() const
+            {
+                return reinterpret_cast<T const *>(&buffer_);
+            }
+
+        private:
+#if !defined(ELEMEL_NO_CXX11)
+            alignas(T) unsigned char buffer_[sizeof(T) * N];
+#else
+            union {
+                unsigned char bytes_[sizeof(T) * N];
+                long double long_double_;
+                long long long_long_;
+                void *pointer_;
+            } buffer_;
+#endif
+        };
+
+        // No storage. The data pointer is null.
+        template <class T>
+        class inline_storage<T, 0> {
+        public:
+            T *data()
+            {
+                return 0;
+            }
+
+            T const *data() const
+            {
+                return 0;
+            }
+        };
+    }
+}
+
+#endif // ELEMEL_INLINE_STORAGE_HPP
@@ -0,0 +1,88 @@
+#ifndef ELEMEL_MUTEX_HPP
+#define ELEMEL_MUTEX_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+
+#if !defined(ELEMEL_NO_CXX11)
+#include <mutex>
+#elif !defined(__GNUC__)
+#error "Mutexes need C++11 or GCC atomic builtins."
+#endif
+
+namespace elemel {
+    namespace detail {
+#if !defined(ELEMEL_NO_CXX11)
+        typedef std::mutex mutex;
+#else
+        // A spin lock, for short critical sections.
+        class mutex {
+        public:
+            mutex() :
+                locked_(false)
+            { }
+
+            void lock()
+            {
+                while (__atomic_test_and_set(&locked_, __ATOMIC_ACQUIRE)) {
+                    while (__atomic_load_n(&locked_, __ATOMIC_RELAXED)) { }
+                }
+            }
+
+            void unlock()
+            {
+                __atomic_clear(&locked_, __ATOMIC_RELEASE);
+            }
+
+        private:
+            bool locked_;
+
+            mutex(mutex const &other);
+            mutex &operator=(mutex const &other);
+        };
+#endif
+
+        // Holds a lock for the lifetime of a scope.
+        template <class Mutex>
+        class lock_guard {
+        public:
+            explicit lock_guard(Mutex &mutex) :
+                mutex_(mutex)
+            {
+                mutex_.lock();
+            }
+
+            ~lock_guard()
+            {
+                mutex_.unlock();
+            }
+
+        private:
+            Mutex &mutex_;
+
+            lock_guard(lock_guard const &other);
+            lock_guard &operator=(lock_guard const &other);
+        };
+    }
+}
+
+#endif // ELEMEL_MUTEX_HPP
@@ -0,0 +1,296 @@
+#ifndef ELEMEL_POOL_HPP
+#define ELEMEL_POOL_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/mutex.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace elemel {
+    namespace detail {
+        // Pooled blocks are prefixed by a header that holds their size
+        // class. The header keeps the payload 16-byte aligned.
+        enum {
+            pool_header_size = 16,
+            pool_small_limit = 256,
+            pool_large_limit = 4096,
+
+            // Classes go in steps of 16 bytes up to the small limit, and in
+            // powers of two up to the large limit. Larger blocks are not
+            // pooled.
+            pool_class_count = 19,
+            pool_large_class = pool_class_count
+        };
+
+        // Size classes include the header. The smallest class is large
+        // enough to hold a free block.
+        inline std::size_t pool_class(std::size_t n)
+        {
+            n += pool_header_size;
+            if (n <= pool_small_limit) {
+                return n <= 32 ? 0 : (n - 1) / 16 - 1;
+            }
+            if (n > pool_large_limit) {
+                return pool_large_class;
+            }
+            std::size_t c = 15;
+            for (std::size_t size = 512; size < n; size *= 2) {
+                ++c;
+            }
+            return c;
+        }
+
+        inline std::size_t pool_class_size(std::size_t c)
+        {
+            return c < 15 ? (c + 2) * 16 : std::size_t(512) << (c - 15);
+        }
+
+        // Blocks move between threads in batches of this many.
+        inline std::size_t pool_batch_size(std::size_t c)
+        {
+            std::size_t n = 16 * 1024 / pool_class_size(c);
+            return n < 4 ? 4 : n > 64 ? 64 : n;
+        }
+
+        struct pool_block {
+            pool_block *next;
+
+            // Only set on the first block of a batch in the depot.
+            pool_block *next_batch;
+            std::size_t count;
+        };
+
+        // Free blocks shared between threads, in batches.
+        class pool_depot {
+        public:
+            // The depot is never destroyed, so that pooled strings can be
+            // released during static destruction.
+            static pool_depot &instance()
+            {
+                static pool_depot *depot = new pool_depot;
+                return *depot;
+            }
+
+            // Takes a batch of free blocks, linked by next, and returns its
+            // first block. New blocks are carved from fresh memory when the
+            // depot is empty.
+            pool_block *pop_batch(std::size_t c, std::size_t &count)
+            {
+                {
+                    lock_guard<mutex> lock(bins_[c].mutex_);
+                    if (pool_block *batch = bins_[c].batches) {
+                        bins_[c].batches = batch->next_batch;
+                        count = batch->count;
+                        return batch;
+                    }
+                }
+                count = pool_batch_size(c);
+                return carve(c, count);
+            }
+
+            // Gives a list of free blocks, linked by next, to the depot.
+            void push_batch(std::size_t c, pool_block *first, std::size_t count)
+            {
+                first->count = count;
+                lock_guard<mutex> lock(bins_[c].mutex_);
+                first->next_batch = bins_[c].batches;
+                bins_[c].batches = first;
+            }
+
+        private:
+            struct bin {
+                mutex mutex_;
+                pool_block *batches;
+
+                bin() :
+                    batches(0)
+                { }
+            };
+
+            bin bins_[pool_class_count];
+
+            pool_depot()
+            { }
+
+            pool_depot(pool_depot const &other);
+            pool_depot &operator=(pool_depot const &other);
+
+            // Pooled memory is never given back, since its blocks can be
+            // cached by any thread.
+            static pool_block *carve(std::size_t c, std::size_t count)
+            {
+                std::size_t size = pool_class_size(c);
+                char *slab = static_cast<char *>(::operator new(count * size));
+                for (std::size_t i = 0; i + 1 < count; ++i) {
+                    reinterpret_cast<pool_block *>(slab + i * size)->next =
+                        reinterpret_cast<pool_block *>(slab + (i + 1) * size);
+                }
+                reinterpret_cast<pool_block *>(slab + (count - 1) * size)->next =
+                    0;
+                return reinterpret_cast<pool_block *>(slab);
+            }
+        };
+
+        // Free blocks cached by one thread. Up to two batches per class are
+        // kept before one is returned to the depot.
+        class pool_cache {
+        public:
+            pool_cache()
+            {
+                for (std::size_t c = 0; c != pool_class_count; ++c) {
+                    lists_[c] = 0;
+                    counts_[c] = 0;
+                }
+            }
+
+            ~pool_cache()
+            {
+                for (std::size_t c = 0; c != pool_class_count; ++c) {
+                    if (lists_[c]) {
+                        pool_depot::instance().push_batch(c, lists_[c],
+                                                          counts_[c]);
+                    }
+                }
+            }
+
+            pool_block *allocate(std::size_t c)
+            {
+                pool_block *block = lists_[c];
+                if (!block) {
+                    block = pool_depot::instance().pop_batch(c, counts_[c]);
+                }
+                lists_[c] = block->next;
+                --counts_[c];
+                return block;
+            }
+
+            void deallocate(pool_block *block, std::size_t c)
+            {
+                block->next = lists_[c];
+                lists_[c] = block;
+                if (++counts_[c] == 2 * pool_batch_size(c)) {
+                    release_batch(c);
+                }
+            }
+
+        private:
+            pool_block *lists_[pool_class_count];
+            std::size_t counts_[pool_class_count];
+
+            pool_cache(pool_cache const &other);
+            pool_cache &operator=(pool_cache const &other);
+
+            void release_batch(std::size_t c)
+            {
+                std::size_t count = pool_batch_size(c);
+                pool_block *first = lists_[c];
+                pool_block *last = first;
+                for (std::size_t i = 1; i != count; ++i) {
+                    last = last->next;
+                }
+                lists_[c] = last->next;
+                counts_[c] -= count;
+                last->next = 0;
+                pool_depot::instance().push_batch(c, first, count);
+            }
+        };
+
+#if !defined(ELEMEL_NO_CXX11)
+        struct pool_thread_state {
+            pool_cache *cache;
+            bool exited;
+        };
+
+        inline pool_thread_state &pool_state()
+        {
+            static thread_local pool_thread_state state = { 0, false };
+            return state;
+        }
+
+        class pool_thread_cache : public pool_cache {
+        public:
+            ~pool_thread_cache()
+            {
+                pool_state().cache = 0;
+                pool_state().exited = true;
+            }
+        };
+#endif
+
+        // The cache of the calling thread, or null if the thread is
+        // exiting and its cache is already gone.
+        inline pool_cache *thread_pool_cache()
+        {
+#if !defined(ELEMEL_NO_CXX11)
+            pool_thread_state &state = pool_state();
+            if (!state.cache && !state.exited) {
+                static thread_local pool_thread_cache instance;
+                state.cache = &instance;
+            }
+            return state.cache;
+#else
+            // Without thread_local, the cache of a thread is never
+            // destroyed, and blocks cached by an exited thread are lost.
+            static __thread pool_cache *cache = 0;
+            if (!cache) {
+                cache = new pool_cache;
+            }
+            return cache;
+#endif
+        }
+
+        inline void *pool_allocate(std::size_t n)
+        {
+            std::size_t c = pool_class(n);
+            pool_cache *cache = thread_pool_cache();
+            char *block;
+            if (c == pool_large_class || !cache) {
+                c = pool_large_class;
+                block = static_cast<char *>(
+                    ::operator new(pool_header_size + n));
+            } else {
+                block = reinterpret_cast<char *>(cache->allocate(c));
+            }
+            *reinterpret_cast<std::size_t *>(block) = c;
+            return block + pool_header_size;
+        }
+
+        inline void pool_deallocate(void *p)
+        {
+            char *block = static_cast<char *>(p) - pool_header_size;
+            std::size_t c = *reinterpret_cast<std::size_t *>(block);
+            if (c == pool_large_class) {
+                ::operator delete(static_cast<void *>(block));
+            } else if (pool_cache *cache = thread_pool_cache()) {
+                cache->deallocate(reinterpret_cast<pool_block *>(block), c);
+            } else {
+                pool_block *b = reinterpret_cast<pool_block *>(block);
+                b->next = 0;
+                pool_depot::instance().push_batch(c, b, 1);
+            }
+        }
+    }
+}
+
+#endif // ELEMEL_POOL_HPP
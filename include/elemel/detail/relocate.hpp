@@ -0,0 +1,119 @@
+#ifndef ELEMEL_RELOCATE_HPP
+#define ELEMEL_RELOCATE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/is_trivially_relocatable.hpp>
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/type_traits.hpp>
+
+#include <cstring>
+
+namespace elemel {
+    namespace detail {
+        // Tells if an allocator has a member function reallocate(p, old_n,
+        // new_n) that grows or shrinks a block, moving its bytes if needed.
+        template <class Allocator>
+        struct has_reallocate : false_type { };
+
+        template <class Allocator, class T>
+        void destroy(Allocator &allocator, T *first, T *last)
+        {
+            for (; first != last; ++first) {
+                allocator.destroy(first);
+            }
+        }
+
+        template <class Allocator, class T>
+        T *relocate_construct(Allocator &allocator, T *first, T *last,
+                              T *result, true_type)
+        {
+            if (first != last) {
+                std::memcpy(static_cast<void *>(result),
+                            static_cast<void const *>(first),
+                            (last - first) * sizeof(T));
+            }
+            return result + (last - first);
+        }
+
+        template <class Allocator, class T>
+        T *relocate_construct(Allocator &allocator, T *first, T *last,
+                              T *result, false_type)
+        {
+            T *i = result;
+            try {
+                for (; first != last; ++first, ++i) {
+                    allocator.construct(i, ELEMEL_MOVE_IF_NOEXCEPT(*first));
+                }
+            } catch (...) {
+                destroy(allocator, result, i);
+                throw;
+            }
+            return i;
+        }
+
+        // Relocation moves values to uninitialized storage in two steps, so
+        // that a failed move leaves the originals intact. The first step
+        // constructs the new values. For trivially relocatable types, it
+        // copies the bytes. Otherwise, it moves the values if moving cannot
+        // throw, and copies them if it can.
+        //
+        // Exception safety: Strong guarantee.
+        template <class Allocator, class T>
+        T *relocate_construct(Allocator &allocator, T *first, T *last,
+                              T *result)
+        {
+            typedef typename is_trivially_relocatable<T>::type
+                is_trivially_relocatable_type;
+
+            return relocate_construct(allocator, first, last, result,
+                                      is_trivially_relocatable_type());
+        }
+
+        template <class Allocator, class T>
+        void relocate_destroy(Allocator &allocator, T *first, T *last,
+                              true_type)
+        { }
+
+        template <class Allocator, class T>
+        void relocate_destroy(Allocator &allocator, T *first, T *last,
+                              false_type)
+        {
+            destroy(allocator, first, last);
+        }
+
+        // The second step of relocation ends the lives of the original
+        // values.
+        //
+        // Exception safety: No-throw guarantee.
+        template <class Allocator, class T>
+        void relocate_destroy(Allocator &allocator, T *first, T *last)
+        {
+            typedef typename is_trivially_relocatable<T>::type
+                is_trivially_relocatable_type;
+
+            relocate_destroy(allocator, first, last,
+                             is_trivially_relocatable_type());
+        }
+    }
+}
+
+#endif // ELEMEL_RELOCATE_HPP
@@ -0,0 +1,41 @@
+#ifndef ELEMEL_SIMD_HPP
+#define ELEMEL_SIMD_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Vectorized kernels are selected at compile time from the instruction sets
+// that the compiler targets. Define ELEMEL_NO_SIMD to use the scalar code
+// everywhere.
+
+#if !defined(ELEMEL_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#   define ELEMEL_SSE2
+#   include <emmintrin.h>
+#   if defined(__SSE4_2__)
+#       define ELEMEL_SSE4_2
+#       include <nmmintrin.h>
+#   endif
+#   if defined(__AVX2__)
+#       define ELEMEL_AVX2
+#       include <immintrin.h>
+#   endif
+#endif
+
+#endif // ELEMEL_SIMD_HPP
@@ -0,0 +1,196 @@
+#ifndef ELEMEL_STRING_COMPARE_HPP
+#define ELEMEL_STRING_COMPARE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/simd.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace elemel {
+    namespace detail {
+        // Compares [first, last) with a terminated string in a single pass,
+        // without first computing the length of the terminated string.
+
+#if defined(ELEMEL_SSE2)
+        // Whether 16 bytes can be read from p without crossing a page.
+        inline bool within_page(char const *p)
+        {
+            return (reinterpret_cast<std::size_t>(p) & 4095) <= 4096 - 16;
+        }
+
+        // Skips the 16-byte blocks that are equal and do not contain the
+        // terminator. Reads past the terminator, within the same page. Near
+        // the end of a page, steps to the next page one character at a
+        // time.
+        ELEMEL_NO_SANITIZE_ADDRESS
+        inline void skip_equal_terminated(char const *&first,
+                                          char const *last,
+                                          char const *&str)
+        {
+            __m128i zero = _mm_setzero_si128();
+            while (last - first >= 16) {
+                if (!within_page(str)) {
+                    char const *end = str +
+                        (4096 - (reinterpret_cast<std::size_t>(str) & 4095));
+                    for (; str != end; ++first, ++str) {
+                        if (*str == '\0' || *str != *first) {
+                            return;
+                        }
+                    }
+                    continue;
+                }
+                __m128i a = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first));
+                __m128i b = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(str));
+                unsigned mask =
+                    ((unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) ^
+                      0xffff) |
+                     unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(b, zero))));
+                if (mask) {
+                    std::size_t i = __builtin_ctz(mask);
+                    first += i;
+                    str += i;
+                    return;
+                }
+                first += 16;
+                str += 16;
+            }
+        }
+#endif
+
+        inline bool equal_terminated(char const *first, char const *last,
+                                     char const *str)
+        {
+#if defined(ELEMEL_SSE2)
+            skip_equal_terminated(first, last, str);
+#endif
+            for (; first != last; ++first, ++str) {
+                if (*str == '\0' || *str != *first) {
+                    return false;
+                }
+            }
+            return *str == '\0';
+        }
+
+        inline int compare_terminated(char const *first, char const *last,
+                                      char const *str)
+        {
+#if defined(ELEMEL_SSE2)
+            skip_equal_terminated(first, last, str);
+#endif
+            for (; first != last; ++first, ++str) {
+                if (*str == '\0') {
+                    return 1;
+                }
+                if (*str != *first) {
+                    return (static_cast<unsigned char>(*first) <
+                            static_cast<unsigned char>(*str)) ? -1 : 1;
+                }
+            }
+            return *str == '\0' ? 0 : -1;
+        }
+
+        // Compares ranges with Traits::compare(), which is memcmp() or
+        // wmemcmp() for the standard traits.
+        template <class Traits>
+        struct range_compare {
+            typedef typename Traits::char_type char_type;
+
+            static bool equal(char_type const *first1, char_type const *last1,
+                              char_type const *first2, char_type const *last2)
+            {
+                std::size_t n = last1 - first1;
+                return (std::size_t(last2 - first2) == n &&
+                        (n == 0 || Traits::compare(first1, first2, n) == 0));
+            }
+
+            static int compare(char_type const *first1, char_type const *last1,
+                               char_type const *first2, char_type const *last2)
+            {
+                std::size_t n1 = last1 - first1;
+                std::size_t n2 = last2 - first2;
+                std::size_t n = n1 < n2 ? n1 : n2;
+                int result = n == 0 ? 0 : Traits::compare(first1, first2, n);
+                return result != 0 ? result : (n1 < n2 ? -1 : n1 != n2);
+            }
+        };
+
+        // Compares strings with the character comparisons of the traits.
+        // Comparisons with terminated strings are specialized for plain
+        // chars with vectorized kernels.
+        template <class Traits>
+        struct string_compare : range_compare<Traits> {
+            typedef typename Traits::char_type char_type;
+
+            static bool equal_terminated(char_type const *first,
+                                         char_type const *last,
+                                         char_type const *str)
+            {
+                for (; first != last; ++first, ++str) {
+                    if (Traits::eq(*str, char_type()) ||
+                        !Traits::eq(*first, *str))
+                    {
+                        return false;
+                    }
+                }
+                return Traits::eq(*str, char_type());
+            }
+
+            static int compare_terminated(char_type const *first,
+                                          char_type const *last,
+                                          char_type const *str)
+            {
+                for (; first != last; ++first, ++str) {
+                    if (Traits::eq(*str, char_type())) {
+                        return 1;
+                    }
+                    if (!Traits::eq(*first, *str)) {
+                        return Traits::lt(*first, *str) ? -1 : 1;
+                    }
+                }
+                return Traits::eq(*str, char_type()) ? 0 : -1;
+            }
+        };
+
+        template <>
+        struct string_compare<std::char_traits<char> > :
+            range_compare<std::char_traits<char> >
+        {
+            static bool equal_terminated(char const *first, char const *last,
+                                         char const *str)
+            {
+                return detail::equal_terminated(first, last, str);
+            }
+
+            static int compare_terminated(char const *first,
+                                          char const *last, char const *str)
+            {
+                return detail::compare_terminated(first, last, str);
+            }
+        };
+    }
+}
+
+#endif // ELEMEL_STRING_COMPARE_HPP
@@ -1,8 +1,26 @@
 #ifndef ELEMEL_STRING_IMPL_HPP
 #define ELEMEL_STRING_IMPL_HPP
 
+#include <elemel/hash_string.hpp>
+#include <elemel/ref_count.hpp>
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/type_traits.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <string>
+
 namespace elemel {
     namespace detail {
+        // Tells if the traits compare characters exactly, so that equal
+        // strings have equal hashes.
+        template <class Traits>
+        struct is_exact_char_traits : false_type { };
+
+        template <class Char>
+        struct is_exact_char_traits<std::char_traits<Char> > : true_type { };
+
         template <class Char, class RefCount, class RawAllocator>
         class string_impl {
         public:
@@ -29,12 +47,16 @@ namespace elemel {
             void release()
             {
                 if (--ref_count_ == 0) {
-                    raw_allocator_type alloc(alloc_);
-                    this->~string_impl();
-                    alloc.deallocate(reinterpret_cast<void *>(this));
+                    destroy();
                 }
             }
     
+            // Prepares the reference count for use from several threads.
+            void share()
+            {
+                share_ref_count(ref_count_);
+            }
+
             value_type *data()
             {
                 return reinterpret_cast<value_type *>(reinterpret_cast<unsigned char *>(this) +
@@ -46,20 +68,51 @@ namespace elemel {
                 return size_;
             }
 
+            // The hash of the characters, as computed by hash_string() when
+            // the string was created.
+            std::size_t hash() const
+            {
+                return hash_;
+            }
+
+            // Interned strings are never freed. Their reference counts are
+            // made immortal, so that releases never bring them to zero.
+            void mark_interned()
+            {
+                interned_ = true;
+                make_ref_count_immortal(ref_count_);
+            }
+
+            bool interned() const
+            {
+                return interned_;
+            }
+
         private:
             size_type size_;
+            std::size_t hash_;
             raw_allocator_type alloc_;
+            bool interned_;
             ref_count_type ref_count_;
     
             string_impl(value_type const *str, size_type n,
                         raw_allocator_type const &alloc) :
                 size_(n),
+                hash_(hash_string(str, str + n)),
                 alloc_(alloc),
+                interned_(false),
                 ref_count_(0)
             {
                 std::copy(str, str + n, data());
                 data()[n] = value_type(0);
             }
+
+            ELEMEL_NOINLINE void destroy()
+            {
+                raw_allocator_type alloc(alloc_);
+                this->~string_impl();
+                alloc.deallocate(reinterpret_cast<void *>(this));
+            }
         };
     }
 }
@@ -0,0 +1,334 @@
+#ifndef ELEMEL_STRING_SEARCH_HPP
+#define ELEMEL_STRING_SEARCH_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/simd.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace elemel {
+    namespace detail {
+        // Search kernels for plain chars. They return null when nothing is
+        // found.
+
+        inline char const *find_char(char const *first, char const *last,
+                                     char c)
+        {
+#if defined(ELEMEL_SSE2)
+#if defined(ELEMEL_AVX2)
+            __m256i c32 = _mm256_set1_epi8(c);
+            for (; last - first >= 32; first += 32) {
+                __m256i x = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(first));
+                unsigned mask = unsigned(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, c32)));
+                if (mask) {
+                    return first + __builtin_ctz(mask);
+                }
+            }
+#endif
+            __m128i c16 = _mm_set1_epi8(c);
+            for (; last - first >= 16; first += 16) {
+                __m128i x = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first));
+                unsigned mask = unsigned(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(x, c16)));
+                if (mask) {
+                    return first + __builtin_ctz(mask);
+                }
+            }
+#endif
+            for (; first != last; ++first) {
+                if (*first == c) {
+                    return first;
+                }
+            }
+            return 0;
+        }
+
+        inline char const *rfind_char(char const *first, char const *last,
+                                      char c)
+        {
+#if defined(ELEMEL_SSE2)
+#if defined(ELEMEL_AVX2)
+            __m256i c32 = _mm256_set1_epi8(c);
+            while (last - first >= 32) {
+                last -= 32;
+                __m256i x = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(last));
+                unsigned mask = unsigned(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, c32)));
+                if (mask) {
+                    return last + 31 - __builtin_clz(mask);
+                }
+            }
+#endif
+            __m128i c16 = _mm_set1_epi8(c);
+            while (last - first >= 16) {
+                last -= 16;
+                __m128i x = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(last));
+                unsigned mask = unsigned(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(x, c16)));
+                if (mask) {
+                    return last + 31 - __builtin_clz(mask);
+                }
+            }
+#endif
+            while (last != first) {
+                if (*--last == c) {
+                    return last;
+                }
+            }
+            return 0;
+        }
+
+        inline char const *find_first_of(char const *first, char const *last,
+                                          char const *set, std::size_t n)
+        {
+            if (n == 0) {
+                return 0;
+            }
+            if (n == 1) {
+                return find_char(first, last, *set);
+            }
+#if defined(ELEMEL_SSE2)
+            // Small sets are matched with one comparison per member.
+            if (n <= 8) {
+                __m128i set16[8];
+                for (std::size_t i = 0; i != n; ++i) {
+                    set16[i] = _mm_set1_epi8(set[i]);
+                }
+                for (; last - first >= 16; first += 16) {
+                    __m128i x = _mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(first));
+                    __m128i eq = _mm_cmpeq_epi8(x, set16[0]);
+                    for (std::size_t i = 1; i != n; ++i) {
+                        eq = _mm_or_si128(eq, _mm_cmpeq_epi8(x, set16[i]));
+                    }
+                    unsigned mask = unsigned(_mm_movemask_epi8(eq));
+                    if (mask) {
+                        return first + __builtin_ctz(mask);
+                    }
+                }
+            }
+#endif
+            bool table[256] = { false };
+            for (std::size_t i = 0; i != n; ++i) {
+                table[static_cast<unsigned char>(set[i])] = true;
+            }
+            for (; first != last; ++first) {
+                if (table[static_cast<unsigned char>(*first)]) {
+                    return first;
+                }
+            }
+            return 0;
+        }
+
+        // Candidates are found by comparing the first and last characters of
+        // the needle in parallel, and then checked with memcmp.
+        inline char const *find_substring(char const *first,
+                                           char const *last,
+                                           char const *needle, std::size_t n)
+        {
+            if (n == 0) {
+                return first;
+            }
+            if (std::size_t(last - first) < n) {
+                return 0;
+            }
+            if (n == 1) {
+                return find_char(first, last, *needle);
+            }
+            char const *end = last - n + 1;
+#if defined(ELEMEL_SSE2)
+#if defined(ELEMEL_AVX2)
+            __m256i front32 = _mm256_set1_epi8(needle[0]);
+            __m256i back32 = _mm256_set1_epi8(needle[n - 1]);
+            for (; end - first >= 32; first += 32) {
+                __m256i front = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(first));
+                __m256i back = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(first + n - 1));
+                unsigned mask = unsigned(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(front, front32),
+                                     _mm256_cmpeq_epi8(back, back32))));
+                for (; mask; mask &= mask - 1) {
+                    char const *p = first + __builtin_ctz(mask);
+                    if (std::memcmp(p + 1, needle + 1, n - 2) == 0) {
+                        return p;
+                    }
+                }
+            }
+#endif
+            __m128i front16 = _mm_set1_epi8(needle[0]);
+            __m128i back16 = _mm_set1_epi8(needle[n - 1]);
+            for (; end - first >= 16; first += 16) {
+                __m128i front = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first));
+                __m128i back = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(first + n - 1));
+                unsigned mask = unsigned(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(front, front16),
+                                  _mm_cmpeq_epi8(back, back16))));
+                for (; mask; mask &= mask - 1) {
+                    char const *p = first + __builtin_ctz(mask);
+                    if (std::memcmp(p + 1, needle + 1, n - 2) == 0) {
+                        return p;
+                    }
+                }
+            }
+#endif
+            for (; first != end; ++first) {
+                if (*first == needle[0] &&
+                    std::memcmp(first + 1, needle + 1, n - 1) == 0)
+                {
+                    return first;
+                }
+            }
+            return 0;
+        }
+
+        inline char const *rfind_substring(char const *first,
+                                            char const *last,
+                                            char const *needle, std::size_t n)
+        {
+            if (std::size_t(last - first) < n) {
+                return 0;
+            }
+            if (n == 0) {
+                return last;
+            }
+            char const *end = last - n + 1;
+            while (char const *p = rfind_char(first, end, *needle)) {
+                if (std::memcmp(p + 1, needle + 1, n - 1) == 0) {
+                    return p;
+                }
+                end = p;
+            }
+            return 0;
+        }
+
+        // Searches strings with the character comparisons of the traits.
+        // Specialized for plain chars with vectorized kernels.
+        template <class Traits>
+        struct string_search {
+            typedef typename Traits::char_type char_type;
+
+            static char_type const *find(char_type const *first,
+                                         char_type const *last, char_type c)
+            {
+                return Traits::find(first, last - first, c);
+            }
+
+            static char_type const *rfind(char_type const *first,
+                                          char_type const *last, char_type c)
+            {
+                while (last != first) {
+                    if (Traits::eq(*--last, c)) {
+                        return last;
+                    }
+                }
+                return 0;
+            }
+
+            static char_type const *find_first_of(char_type const *first,
+                                                  char_type const *last,
+                                                  char_type const *set,
+                                                  std::size_t n)
+            {
+                for (; first != last; ++first) {
+                    if (Traits::find(set, n, *first)) {
+                        return first;
+                    }
+                }
+                return 0;
+            }
+
+            static char_type const *find(char_type const *first,
+                                         char_type const *last,
+                                         char_type const *needle,
+                                         std::size_t n)
+            {
+                char_type const *result = std::search(first, last, needle,
+                                                      needle + n, Traits::eq);
+                return (result == last && n != 0) ? 0 : result;
+            }
+
+            static char_type const *rfind(char_type const *first,
+                                          char_type const *last,
+                                          char_type const *needle,
+                                          std::size_t n)
+            {
+                if (std::size_t(last - first) < n) {
+                    return 0;
+                }
+                if (n == 0) {
+                    return last;
+                }
+                char_type const *result = std::find_end(first, last, needle,
+                                                        needle + n,
+                                                        Traits::eq);
+                return result == last ? 0 : result;
+            }
+        };
+
+        template <>
+        struct string_search<std::char_traits<char> > {
+            static char const *find(char const *first, char const *last,
+                                    char c)
+            {
+                return find_char(first, last, c);
+            }
+
+            static char const *rfind(char const *first, char const *last,
+                                     char c)
+            {
+                return rfind_char(first, last, c);
+            }
+
+            static char const *find_first_of(char const *first,
+                                             char const *last,
+                                             char const *set, std::size_t n)
+            {
+                return detail::find_first_of(first, last, set, n);
+            }
+
+            static char const *find(char const *first, char const *last,
+                                    char const *needle, std::size_t n)
+            {
+                return find_substring(first, last, needle, n);
+            }
+
+            static char const *rfind(char const *first, char const *last,
+                                     char const *needle, std::size_t n)
+            {
+                return rfind_substring(first, last, needle, n);
+            }
+        };
+    }
+}
+
+#endif // ELEMEL_STRING_SEARCH_HPP
@@ -0,0 +1,67 @@
+#ifndef ELEMEL_TYPE_TRAITS_HPP
+#define ELEMEL_TYPE_TRAITS_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+namespace elemel {
+    namespace detail {
+        template <bool Value>
+        struct bool_constant {
+            typedef bool_constant type;
+            static bool const value = Value;
+        };
+
+        typedef bool_constant<true> true_type;
+        typedef bool_constant<false> false_type;
+
+        template <class T>
+        struct is_arithmetic : false_type { };
+
+        template <class T>
+        struct is_arithmetic<T const> : is_arithmetic<T> { };
+
+        template <> struct is_arithmetic<bool> : true_type { };
+        template <> struct is_arithmetic<char> : true_type { };
+        template <> struct is_arithmetic<signed char> : true_type { };
+        template <> struct is_arithmetic<unsigned char> : true_type { };
+        template <> struct is_arithmetic<wchar_t> : true_type { };
+        template <> struct is_arithmetic<short> : true_type { };
+        template <> struct is_arithmetic<unsigned short> : true_type { };
+        template <> struct is_arithmetic<int> : true_type { };
+        template <> struct is_arithmetic<unsigned int> : true_type { };
+        template <> struct is_arithmetic<long> : true_type { };
+        template <> struct is_arithmetic<unsigned long> : true_type { };
+        template <> struct is_arithmetic<long long> : true_type { };
+        template <> struct is_arithmetic<unsigned long long> : true_type { };
+        template <> struct is_arithmetic<float> : true_type { };
+        template <> struct is_arithmetic<double> : true_type { };
+        template <> struct is_arithmetic<long double> : true_type { };
+
+        // Tells if an ordering can also compare in three ways, with a static
+        // compare(comp, left, right) that returns a negative number, zero or
+        // a positive number. Searches then tell equivalence from a single
+        // comparison. Specialized by the string types for std::less.
+        template <class Compare>
+        struct three_way_compare : false_type { };
+    }
+}
+
+#endif // ELEMEL_TYPE_TRAITS_HPP
@@ -0,0 +1,223 @@
+#ifndef ELEMEL_EYTZINGER_LAYOUT_HPP
+#define ELEMEL_EYTZINGER_LAYOUT_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/binary_find.hpp>
+#include <elemel/copying_vector.hpp>
+#include <elemel/detail/config.hpp>
+
+#include <cstddef>
+#include <utility>
+
+namespace elemel {
+    // Keeps a copy of the keys of a flat map in Eytzinger (breadth-first)
+    // order, apart from the data. The first levels of the implicit tree share
+    // a few cache lines, and the descendants four levels down are prefetched,
+    // so a search touches far fewer cache lines than a binary search over the
+    // sorted values. The index is rebuilt in linear time whenever the map is
+    // modified, so this layout suits maps that are loaded in bulk and then
+    // mostly read.
+    struct eytzinger_layout {
+        template <class Key, class Compare, class Allocator>
+        class index {
+        public:
+            typedef Key key_type;
+            typedef Compare compare;
+            typedef Allocator allocator_type;
+            typedef std::size_t size_type;
+
+            explicit index(allocator_type const &allocator = allocator_type()) :
+                keys_(key_allocator_type(allocator)),
+                positions_(position_allocator_type(allocator))
+            { }
+
+            // Exception safety: Strong guarantee.
+            template <class RandomAccessIterator>
+            void rebuild(RandomAccessIterator first, RandomAccessIterator last)
+            {
+                index temp(keys_.get_allocator());
+                size_type n = last - first;
+                if (n != 0) {
+                    // Slot zero is unused, so that the children of slot k are
+                    // slots 2k and 2k + 1.
+                    temp.keys_.resize(n + 1, key_of(*first));
+                    temp.positions_.resize(n + 1, 0);
+                    size_type position = 0;
+                    temp.fill(first, 1, position);
+                }
+                swap(temp);
+            }
+
+            template <class RandomAccessIterator>
+            RandomAccessIterator find(RandomAccessIterator first,
+                                      RandomAccessIterator last,
+                                      key_type const &key,
+                                      compare const &comp) const
+            {
+                if (keys_.empty()) {
+                    return last;
+                }
+                key_type const *keys = keys_.begin();
+                size_type n = keys_.size() - 1;
+                size_type k = 1;
+                while (k <= n) {
+                    ELEMEL_PREFETCH(keys + k * prefetch_stride);
+                    k = 2 * k + comp(keys[k], key);
+                }
+
+                // Backtrack to the last slot where the search went left,
+                // which holds the lower bound.
+                k >>= trailing_ones(k) + 1;
+                if (k == 0 || comp(key, keys[k])) {
+                    return last;
+                }
+                return first + positions_[k];
+            }
+
+            // Sorted batches are merged with the sorted values, and other
+            // batches descend the tree a group at a time, in lockstep.
+            template <class RandomAccessIterator, class ForwardIterator,
+                      class OutputIterator>
+            OutputIterator find_many(RandomAccessIterator first,
+                                     RandomAccessIterator last,
+                                     ForwardIterator keys_first,
+                                     ForwardIterator keys_last,
+                                     OutputIterator out,
+                                     compare const &comp) const
+            {
+                if (keys_.empty() ||
+                    detail::is_sorted(keys_first, keys_last, comp))
+                {
+                    return binary_find_many(first, last, keys_first,
+                                            keys_last, out, comp);
+                }
+
+                key_type const *keys = keys_.begin();
+                size_type n = keys_.size() - 1;
+
+                // Every search descends all complete levels of the tree.
+                int depth = 0;
+                while ((size_type(2) << depth) - 1 <= n) {
+                    ++depth;
+                }
+
+                enum { group_size = 8 };
+                ForwardIterator group_keys[group_size];
+                size_type slots[group_size];
+                while (keys_first != keys_last) {
+                    int m = 0;
+                    for (; m < group_size && keys_first != keys_last;
+                         ++m, ++keys_first)
+                    {
+                        group_keys[m] = keys_first;
+                        slots[m] = 1;
+                    }
+                    for (int d = 0; d < depth; ++d) {
+                        for (int j = 0; j < m; ++j) {
+                            ELEMEL_PREFETCH(keys + slots[j] * prefetch_stride);
+                        }
+                        for (int j = 0; j < m; ++j) {
+                            slots[j] = (2 * slots[j] +
+                                        comp(keys[slots[j]], *group_keys[j]));
+                        }
+                    }
+                    for (int j = 0; j < m; ++j) {
+                        size_type k = slots[j];
+                        if (k <= n) {
+                            k = 2 * k + comp(keys[k], *group_keys[j]);
+                        }
+                        k >>= trailing_ones(k) + 1;
+                        if (k == 0 || comp(*group_keys[j], keys[k])) {
+                            *out = last;
+                        } else {
+                            *out = first + positions_[k];
+                        }
+                        ++out;
+                    }
+                }
+                return out;
+            }
+
+            // Exception safety: No-throw guarantee.
+            void swap(index &other)
+            {
+                keys_.swap(other.keys_);
+                positions_.swap(other.positions_);
+            }
+
+        private:
+            typedef typename allocator_type::template rebind<key_type>::other
+                key_allocator_type;
+            typedef typename allocator_type::template rebind<size_type>::other
+                position_allocator_type;
+
+            // The descendants of slot k four levels down are the sixteen
+            // consecutive slots starting at slot 16k.
+            enum { prefetch_stride = 16 };
+
+            copying_vector<key_type, key_allocator_type> keys_;
+            copying_vector<size_type, position_allocator_type> positions_;
+
+            template <class RandomAccessIterator>
+            void fill(RandomAccessIterator first, size_type k,
+                      size_type &position)
+            {
+                if (k < keys_.size()) {
+                    fill(first, 2 * k, position);
+                    keys_[k] = key_of(first[position]);
+                    positions_[k] = position;
+                    ++position;
+                    fill(first, 2 * k + 1, position);
+                }
+            }
+
+            // The index is built from the values of a flat map, or from the
+            // keys alone.
+            static key_type const &key_of(key_type const &key)
+            {
+                return key;
+            }
+
+            template <class Data>
+            static key_type const &key_of(std::pair<key_type, Data> const &value)
+            {
+                return value.first;
+            }
+
+            static size_type trailing_ones(size_type k)
+            {
+#if defined(__GNUC__)
+                return __builtin_ctzll(~static_cast<unsigned long long>(k));
+#else
+                size_type result = 0;
+                while (k & 1) {
+                    k >>= 1;
+                    ++result;
+                }
+                return result;
+#endif
+            }
+        };
+    };
+}
+
+#endif // ELEMEL_EYTZINGER_LAYOUT_HPP
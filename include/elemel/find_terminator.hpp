@@ -1,6 +1,10 @@
 #ifndef ELEMEL_FIND_TERMINATOR_HPP
 #define ELEMEL_FIND_TERMINATOR_HPP
 
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/simd.hpp>
+
+#include <cstddef>
 #include <iterator>
 
 namespace elemel {
@@ -21,6 +25,163 @@ namespace elemel {
 
         return find_terminator(i, value_type());
     }
+
+    namespace detail {
+        // The kernels read whole aligned blocks, which never cross a page
+        // boundary, so it is safe to read past the terminator.
+
+        ELEMEL_NO_SANITIZE_ADDRESS
+        inline char const *find_char_terminator(char const *i,
+                                                char terminator)
+        {
+#if defined(ELEMEL_AVX2)
+            std::size_t offset = reinterpret_cast<std::size_t>(i) & 31;
+            char const *block = i - offset;
+            __m256i terminator32 = _mm256_set1_epi8(terminator);
+            unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                _mm256_load_si256(reinterpret_cast<__m256i const *>(block)),
+                terminator32))) >> offset;
+            if (mask) {
+                return i + __builtin_ctz(mask);
+            }
+            for (;;) {
+                block += 32;
+                mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                    _mm256_load_si256(
+                        reinterpret_cast<__m256i const *>(block)),
+                    terminator32)));
+                if (mask) {
+                    return block + __builtin_ctz(mask);
+                }
+            }
+#elif defined(ELEMEL_SSE2)
+            std::size_t offset = reinterpret_cast<std::size_t>(i) & 15;
+            char const *block = i - offset;
+            __m128i terminator16 = _mm_set1_epi8(terminator);
+            unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_load_si128(reinterpret_cast<__m128i const *>(block)),
+                terminator16))) >> offset;
+            if (mask) {
+                return i + __builtin_ctz(mask);
+            }
+            for (;;) {
+                block += 16;
+                mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                    _mm_load_si128(reinterpret_cast<__m128i const *>(block)),
+                    terminator16)));
+                if (mask) {
+                    return block + __builtin_ctz(mask);
+                }
+            }
+#elif defined(__GNUC__)
+            // Checks a word at a time for a byte that matches the
+            // terminator, and then finds it within the word.
+            typedef std::size_t __attribute__((__may_alias__)) word_type;
+            std::size_t const ones = std::size_t(-1) / 255;
+            std::size_t const pattern =
+                ones * static_cast<unsigned char>(terminator);
+            for (; reinterpret_cast<std::size_t>(i) % sizeof(word_type);
+                 ++i)
+            {
+                if (*i == terminator) {
+                    return i;
+                }
+            }
+            for (;; i += sizeof(word_type)) {
+                std::size_t x =
+                    *reinterpret_cast<word_type const *>(i) ^ pattern;
+                if ((x - ones) & ~x & (ones << 7)) {
+                    break;
+                }
+            }
+            while (*i != terminator) {
+                ++i;
+            }
+            return i;
+#else
+            while (*i != terminator) {
+                ++i;
+            }
+            return i;
+#endif
+        }
+
+        ELEMEL_NO_SANITIZE_ADDRESS
+        inline wchar_t const *find_wchar_terminator(wchar_t const *i,
+                                                    wchar_t terminator)
+        {
+#if defined(ELEMEL_SSE2)
+            if ((sizeof(wchar_t) == 2 || sizeof(wchar_t) == 4) &&
+                reinterpret_cast<std::size_t>(i) % sizeof(wchar_t) == 0)
+            {
+                // The mask has one bit per byte, so offsets are in bytes.
+                std::size_t offset = reinterpret_cast<std::size_t>(i) & 15;
+                char const *block = reinterpret_cast<char const *>(i) - offset;
+                __m128i terminator16 = (sizeof(wchar_t) == 2 ?
+                                        _mm_set1_epi16(short(terminator)) :
+                                        _mm_set1_epi32(int(terminator)));
+                for (;; block += 16, offset = 0) {
+                    __m128i x = _mm_load_si128(
+                        reinterpret_cast<__m128i const *>(block));
+                    __m128i eq = (sizeof(wchar_t) == 2 ?
+                                  _mm_cmpeq_epi16(x, terminator16) :
+                                  _mm_cmpeq_epi32(x, terminator16));
+                    unsigned mask = unsigned(_mm_movemask_epi8(eq)) >> offset;
+                    if (mask) {
+                        return reinterpret_cast<wchar_t const *>(
+                            block + offset + __builtin_ctz(mask));
+                    }
+                }
+            }
+#endif
+            while (*i != terminator) {
+                ++i;
+            }
+            return i;
+        }
+    }
+
+    inline char const *find_terminator(char const *i, char terminator)
+    {
+        return detail::find_char_terminator(i, terminator);
+    }
+
+    inline char *find_terminator(char *i, char terminator)
+    {
+        return const_cast<char *>(detail::find_char_terminator(i, terminator));
+    }
+
+    inline char const *find_terminator(char const *i)
+    {
+        return detail::find_char_terminator(i, '\0');
+    }
+
+    inline char *find_terminator(char *i)
+    {
+        return const_cast<char *>(detail::find_char_terminator(i, '\0'));
+    }
+
+    inline wchar_t const *find_terminator(wchar_t const *i,
+                                          wchar_t terminator)
+    {
+        return detail::find_wchar_terminator(i, terminator);
+    }
+
+    inline wchar_t *find_terminator(wchar_t *i, wchar_t terminator)
+    {
+        return const_cast<wchar_t *>(
+            detail::find_wchar_terminator(i, terminator));
+    }
+
+    inline wchar_t const *find_terminator(wchar_t const *i)
+    {
+        return detail::find_wchar_terminator(i, L'\0');
+    }
+
+    inline wchar_t *find_terminator(wchar_t *i)
+    {
+        return const_cast<wchar_t *>(detail::find_wchar_terminator(i, L'\0'));
+    }
 }
 
 #endif // ELEMEL_FIND_TERMINATOR_HPP
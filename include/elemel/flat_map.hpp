@@ -24,13 +24,24 @@
 #include <elemel/binary_find.hpp>
 #include <elemel/copying_vector.hpp>
 #include <elemel/map_pair_compare.hpp>
+#include <elemel/sorted_layout.hpp>
+
+#include <algorithm>
+#include <cassert>
 
 namespace elemel {
+    // Tells insert() and the constructor that the values are sorted by key,
+    // and that each key occurs at most once.
+    enum sorted_unique_tag { sorted_unique };
+
+    // Up to InlineCapacity values are stored inline, without allocating.
     template <
         class Key,
         class Data,
         class Compare = std::less<Key>,
-        class Allocator = std::allocator<std::pair<Key, Data> >
+        class Allocator = std::allocator<std::pair<Key, Data> >,
+        class Layout = sorted_layout,
+        std::size_t InlineCapacity = 0
     >
     class flat_map {
     public:
@@ -40,7 +51,12 @@ namespace elemel {
         typedef Compare key_compare;
         typedef map_pair_compare<Key, key_compare> compare;
         typedef Allocator allocator_type;
-        typedef copying_vector<value_type, allocator_type> vector_type;
+        typedef Layout layout_type;
+        typedef copying_vector<value_type, allocator_type, InlineCapacity>
+            vector_type;
+        typedef typename layout_type::template index<key_type, compare,
+                                                     allocator_type>
+            index_type;
 
         typedef typename vector_type::pointer pointer;
         typedef typename vector_type::reference reference;
@@ -55,7 +71,10 @@ namespace elemel {
         explicit flat_map(key_compare const &comp = key_compare(),
                           allocator_type const &allocator = allocator_type()) :
             comp_(comp),
-            values_(allocator)
+            values_(allocator),
+            index_(allocator),
+            sorted_size_(0),
+            max_unsorted_(0)
         { }
 
         template <class InputIterator>
@@ -63,19 +82,41 @@ namespace elemel {
                  key_compare const &comp = key_compare(),
                  allocator_type const &allocator = allocator_type()) :
             comp_(comp),
-            values_(first, last, allocator)
+            values_(allocator),
+            index_(allocator),
+            sorted_size_(0),
+            max_unsorted_(0)
+        {
+            insert(first, last);
+        }
+
+        template <class InputIterator>
+        flat_map(sorted_unique_tag, InputIterator first, InputIterator last,
+                 key_compare const &comp = key_compare(),
+                 allocator_type const &allocator = allocator_type()) :
+            comp_(comp),
+            values_(allocator),
+            index_(allocator),
+            sorted_size_(0),
+            max_unsorted_(0)
         {
-            std::sort(values_.begin(), values_.end(), comp_);
+            insert(sorted_unique, first, last);
         }
 
         flat_map &operator=(flat_map const &other)
         {
             comp_ = other.comp_;
             values_ = other.values_;
+            index_ = other.index_;
+            sorted_size_ = other.sorted_size_;
+            max_unsorted_ = other.max_unsorted_;
+            return *this;
         }
 
+        // Sorts any pending values first.
         iterator begin()
         {
+            sort_unsorted();
             return values_.begin();
         }
 
@@ -84,8 +125,10 @@ namespace elemel {
             return values_.end();
         }
 
+        // Sorts any pending values first.
         const_iterator begin() const
         {
+            sort_unsorted();
             return values_.begin();
         }
 
@@ -94,8 +137,10 @@ namespace elemel {
             return values_.end();
         }
 
+        // Sorts any pending values first.
         reverse_iterator rbegin()
         {
+            sort_unsorted();
             return values_.rbegin();
         }
 
@@ -104,8 +149,10 @@ namespace elemel {
             return values_.rend();
         }
         
+        // Sorts any pending values first.
         const_reverse_iterator rbegin() const
         {
+            sort_unsorted();
             return values_.rbegin();
         }
 
@@ -129,32 +176,102 @@ namespace elemel {
             return values_.max_size();
         }
 
-        value_type &operator[](key_type const &key)
+        data_type &operator[](key_type const &key)
         {
             return insert(value_type(key, data_type())).first->second;
         }
 
+        // The maximum number of values that insert() appends without
+        // sorting. The default is zero, so that the values are always
+        // sorted.
+        size_type max_unsorted() const
+        {
+            return max_unsorted_;
+        }
+
+        // Lets insert() append up to n values to an unsorted tail. The tail
+        // is sorted and merged when it grows past n, or when begin(),
+        // rbegin() or find_many() is called. find() scans a short tail, and
+        // sorts a longer one. Insertion then takes amortized O(log n) time
+        // per value for bursts of inserts.
+        //
+        // Sorting may happen in const member functions, and invalidates
+        // iterators like insert() does. A const flat_map with an unsorted
+        // tail is not safe to read from several threads.
+        void max_unsorted(size_type n)
+        {
+            max_unsorted_ = n;
+            if (values_.size() - sorted_size_ > max_unsorted_) {
+                sort_unsorted();
+            }
+        }
+
         std::pair<iterator, bool> insert(value_type const &value)
         {
-            std::pair<iterator, iterator> i =
-                std::equal_range(values_.begin(), values_.end(), value, comp_);
-            if (i.first != i.second) {
-                return std::make_pair(i.first, false);
-            } else {
-                return std::make_pair(values_.insert(i.first, value), true);
+            if (max_unsorted_ == 0 && sorted_size_ == values_.size()) {
+                std::pair<iterator, iterator> i =
+                    std::equal_range(values_.begin(), values_.end(), value,
+                                     comp_);
+                if (i.first != i.second) {
+                    return std::make_pair(i.first, false);
+                } else {
+                    iterator j = values_.insert(i.first, value);
+                    ++sorted_size_;
+                    rebuild_index();
+                    return std::make_pair(j, true);
+                }
             }
+            iterator i = find_sorted(value.first);
+            if (i == values_.end()) {
+                i = find_unsorted(value.first);
+            }
+            if (i != values_.end()) {
+                return std::make_pair(i, false);
+            }
+            values_.push_back(value);
+            if (values_.size() - sorted_size_ > max_unsorted_) {
+                sort_unsorted();
+                return std::make_pair(find_sorted(value.first), true);
+            }
+            return std::make_pair(values_.end() - 1, true);
+        }
+
+        // Appends the values, sorts them, and merges them with the values
+        // already in the map. As for single values, a value is not inserted
+        // if its key is already present.
+        template <class InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            sort_unsorted();
+            size_type n = values_.size();
+            values_.insert(values_.end(), first, last);
+            std::stable_sort(values_.begin() + n, values_.end(), comp_);
+            erase_duplicates(values_.begin() + n);
+            merge(n);
+        }
+
+        // Like insert(first, last), but skips the sorting.
+        template <class InputIterator>
+        void insert(sorted_unique_tag, InputIterator first,
+                    InputIterator last)
+        {
+            sort_unsorted();
+            size_type n = values_.size();
+            values_.insert(values_.end(), first, last);
+            assert(is_sorted_unique(values_.begin() + n, values_.end()));
+            merge(n);
         }
 
         void erase(iterator position)
         {
-            values_.erase(position);
+            erase(position, position + 1);
         }
 
         size_type erase(key_type const &key)
         {
             iterator i = find(key);
             if (i != values_.end()) {
-                values_.erase(i);
+                erase(i);
                 return 1;
             } else {
                 return 0;
@@ -163,28 +280,62 @@ namespace elemel {
 
         void erase(iterator first, iterator last)
         {
+            size_type sorted_first = std::min<size_type>(
+                first - values_.begin(), sorted_size_);
+            size_type sorted_last = std::min<size_type>(
+                last - values_.begin(), sorted_size_);
             values_.erase(first, last);
+            sorted_size_ -= sorted_last - sorted_first;
+            rebuild_index();
         }
 
         void swap(flat_map &other)
         {
             std::swap(comp_, other.comp_);
             values_.swap(other.values_);
+            index_.swap(other.index_);
+            std::swap(sorted_size_, other.sorted_size_);
+            std::swap(max_unsorted_, other.max_unsorted_);
         }
 
         void clear()
         {
             values_.clear();
+            sorted_size_ = 0;
+            rebuild_index();
         }
 
         iterator find(key_type const &key)
         {
-            return binary_find(values_.begin(), values_.end(), key, comp_);
+            return find_any(key);
         }
 
         const_iterator find(key_type const &key) const
         {
-            return binary_find(values_.begin(), values_.end(), key, comp_);
+            return find_any(key);
+        }
+
+        // Writes an iterator to the value of each key in the range, or end()
+        // if there is none, to out. This is faster than calling find() for
+        // each key, particularly if the keys are sorted.
+        template <class ForwardIterator, class OutputIterator>
+        OutputIterator find_many(ForwardIterator keys_first,
+                                 ForwardIterator keys_last,
+                                 OutputIterator out)
+        {
+            sort_unsorted();
+            return index_.find_many(values_.begin(), values_.end(),
+                                    keys_first, keys_last, out, comp_);
+        }
+
+        template <class ForwardIterator, class OutputIterator>
+        OutputIterator find_many(ForwardIterator keys_first,
+                                 ForwardIterator keys_last,
+                                 OutputIterator out) const
+        {
+            sort_unsorted();
+            return index_.find_many(values_.begin(), values_.end(),
+                                    keys_first, keys_last, out, comp_);
         }
 
         allocator_type get_allocator() const
@@ -193,18 +344,120 @@ namespace elemel {
         }
 
     private:
+        // find() scans an unsorted tail of up to this many values, rather
+        // than sorting it.
+        static size_type const max_scanned = 8;
+
+        // The values are sorted up to sorted_size_, and the index covers
+        // them. Values after that are unsorted, and their keys are not
+        // found before.
         compare comp_;
-        vector_type values_;
+        mutable vector_type values_;
+        mutable index_type index_;
+        mutable size_type sorted_size_;
+        size_type max_unsorted_;
+
+        void rebuild_index() const
+        {
+            index_.rebuild(values_.begin(), values_.begin() + sorted_size_);
+        }
+
+        // Returns the matching sorted value, or end().
+        iterator find_sorted(key_type const &key) const
+        {
+            iterator middle = values_.begin() + sorted_size_;
+            iterator i = index_.find(values_.begin(), middle, key, comp_);
+            return i != middle ? i : values_.end();
+        }
+
+        // Returns the matching unsorted value, or end().
+        iterator find_unsorted(key_type const &key) const
+        {
+            iterator i = values_.begin() + sorted_size_;
+            for (; i != values_.end(); ++i) {
+                if (detail::equivalent(comp_, *i, key)) {
+                    break;
+                }
+            }
+            return i;
+        }
+
+        iterator find_any(key_type const &key) const
+        {
+            if (values_.size() - sorted_size_ > max_scanned) {
+                sort_unsorted();
+            }
+            iterator i = find_sorted(key);
+            return i != values_.end() ? i : find_unsorted(key);
+        }
+
+        void sort_unsorted() const
+        {
+            if (sorted_size_ != values_.size()) {
+                std::stable_sort(values_.begin() + sorted_size_,
+                                 values_.end(), comp_);
+                merge(sorted_size_);
+            }
+        }
+
+        // Merges the sorted values from position n with the sorted values
+        // before them.
+        void merge(size_type n) const
+        {
+            iterator middle = values_.begin() + n;
+            if (middle != values_.begin() && middle != values_.end() &&
+                !comp_(*(middle - 1), *middle))
+            {
+                std::inplace_merge(values_.begin(), middle, values_.end(),
+                                   comp_);
+                erase_duplicates(values_.begin());
+            }
+            sorted_size_ = values_.size();
+            rebuild_index();
+        }
+
+        // Keeps the first value of each run of equivalent keys, starting at
+        // first, and drops the rest.
+        void erase_duplicates(iterator first) const
+        {
+            if (first != values_.end()) {
+                iterator result = first;
+                for (iterator i = first + 1; i != values_.end(); ++i) {
+                    if (comp_(*result, *i)) {
+                        ++result;
+                        if (result != i) {
+                            *result = *i;
+                        }
+                    }
+                }
+                values_.erase(result + 1, values_.end());
+            }
+        }
+
+        bool is_sorted_unique(const_iterator first, const_iterator last) const
+        {
+            if (first != last) {
+                for (const_iterator i = first + 1; i != last; ++i) {
+                    if (!comp_(*(i - 1), *i)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
     };
 }
 
 namespace std {
-    template <class Key, class Data, class Compare, class Allocator>
-    void swap(elemel::flat_map<Key, Data, Compare, Allocator> &first,
-              elemel::flat_map<Key, Data, Compare, Allocator> &second)
+    template <class Key, class Data, class Compare, class Allocator,
+              class Layout, std::size_t InlineCapacity>
+    void swap(elemel::flat_map<Key, Data, Compare, Allocator, Layout,
+                               InlineCapacity> &first,
+              elemel::flat_map<Key, Data, Compare, Allocator, Layout,
+                               InlineCapacity> &second)
     {
         first.swap(second);
     }
 }
 
-#endif // ELEMEL_PROPERTY_MAP_HPP
+#endif // ELEMEL_FLAT_MAP_HPP
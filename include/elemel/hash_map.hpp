@@ -0,0 +1,726 @@
+#ifndef ELEMEL_HASH_MAP_HPP
+#define ELEMEL_HASH_MAP_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/hash_string.hpp>
+#include <elemel/is_trivially_relocatable.hpp>
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/relocate.hpp>
+#include <elemel/detail/simd.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <tr1/functional>
+
+namespace elemel {
+    namespace detail {
+        // Each slot of a hash map has a control byte. Full slots store the
+        // low seven bits of the hash of their key. The sentinel pads groups
+        // past the last slot, and ends iteration.
+        typedef signed char hash_ctrl;
+
+        enum {
+            ctrl_empty = -128,
+            ctrl_deleted = -2,
+            ctrl_sentinel = -1
+        };
+
+        // The slots of a group that matched, lowest first.
+        template <int Shift>
+        class hash_group_mask {
+        public:
+            explicit hash_group_mask(unsigned long long bits) :
+                bits_(bits)
+            { }
+
+            bool any() const
+            {
+                return bits_ != 0;
+            }
+
+            std::size_t lowest() const
+            {
+#if defined(__GNUC__)
+                return std::size_t(__builtin_ctzll(bits_)) >> Shift;
+#else
+                std::size_t result = 0;
+                for (unsigned long long bits = bits_; !(bits & 1);
+                     bits >>= 1)
+                {
+                    ++result;
+                }
+                return result >> Shift;
+#endif
+            }
+
+            void clear_lowest()
+            {
+                bits_ &= bits_ - 1;
+            }
+
+        private:
+            unsigned long long bits_;
+        };
+
+#if defined(ELEMEL_SSE2)
+        // Matches the control bytes of 16 slots at once.
+        class hash_group {
+        public:
+            enum { width = 16 };
+
+            typedef hash_group_mask<0> mask_type;
+
+            explicit hash_group(hash_ctrl const *ctrl) :
+                ctrl_(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl)))
+            { }
+
+            mask_type match(hash_ctrl h2) const
+            {
+                return mask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_));
+            }
+
+            mask_type match_empty() const
+            {
+                return mask(_mm_cmpeq_epi8(_mm_set1_epi8(ctrl_empty), ctrl_));
+            }
+
+            mask_type match_empty_or_deleted() const
+            {
+                return mask(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel),
+                                           ctrl_));
+            }
+
+        private:
+            __m128i ctrl_;
+
+            static mask_type mask(__m128i x)
+            {
+                return mask_type(unsigned(_mm_movemask_epi8(x)));
+            }
+        };
+#else
+        // Matches the control bytes of 8 slots at once, in a word.
+        class hash_group {
+        public:
+            enum { width = 8 };
+
+            typedef hash_group_mask<3> mask_type;
+
+            explicit hash_group(hash_ctrl const *ctrl) :
+                ctrl_(0)
+            {
+                for (int i = 0; i != width; ++i) {
+                    ctrl_ |= (static_cast<unsigned long long>(
+                                  static_cast<unsigned char>(ctrl[i])) <<
+                              (8 * i));
+                }
+            }
+
+            // May also match full slots next to a match, which is harmless,
+            // since the keys are compared anyway.
+            mask_type match(hash_ctrl h2) const
+            {
+                unsigned long long x =
+                    ctrl_ ^ (lsbs * static_cast<unsigned char>(h2));
+                return mask_type((x - lsbs) & ~x & msbs);
+            }
+
+            mask_type match_empty() const
+            {
+                return mask_type(ctrl_ & ~(ctrl_ << 6) & msbs);
+            }
+
+            mask_type match_empty_or_deleted() const
+            {
+                return mask_type(ctrl_ & ~(ctrl_ << 7) & msbs);
+            }
+
+        private:
+            static unsigned long long const lsbs = 0x0101010101010101ull;
+            static unsigned long long const msbs = 0x8080808080808080ull;
+
+            unsigned long long ctrl_;
+        };
+#endif
+
+        // The control bytes of a map without slots. They are never written.
+        inline hash_ctrl *empty_hash_ctrl()
+        {
+            static hash_ctrl ctrl[17] = {
+                ctrl_sentinel, ctrl_sentinel, ctrl_sentinel, ctrl_sentinel,
+                ctrl_sentinel, ctrl_sentinel, ctrl_sentinel, ctrl_sentinel,
+                ctrl_sentinel, ctrl_sentinel, ctrl_sentinel, ctrl_sentinel,
+                ctrl_sentinel, ctrl_sentinel, ctrl_sentinel, ctrl_sentinel,
+                ctrl_sentinel
+            };
+            return ctrl;
+        }
+
+        template <class Value>
+        class hash_map_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Value *pointer;
+            typedef Value &reference;
+
+            hash_map_iterator() :
+                ctrl_(0),
+                slot_(0)
+            { }
+
+            hash_map_iterator(hash_ctrl const *ctrl, Value *slot) :
+                ctrl_(ctrl),
+                slot_(slot)
+            { }
+
+            template <class Other>
+            hash_map_iterator(hash_map_iterator<Other> const &other) :
+                ctrl_(other.ctrl()),
+                slot_(other.slot())
+            { }
+
+            reference operator*() const
+            {
+                return *slot_;
+            }
+
+            pointer operator->() const
+            {
+                return slot_;
+            }
+
+            hash_map_iterator &operator++()
+            {
+                ++ctrl_;
+                ++slot_;
+                skip_free();
+                return *this;
+            }
+
+            hash_map_iterator operator++(int)
+            {
+                hash_map_iterator result(*this);
+                ++*this;
+                return result;
+            }
+
+            hash_ctrl const *ctrl() const
+            {
+                return ctrl_;
+            }
+
+            Value *slot() const
+            {
+                return slot_;
+            }
+
+            // Skips empty and deleted slots.
+            void skip_free()
+            {
+                while (*ctrl_ < ctrl_sentinel) {
+                    ++ctrl_;
+                    ++slot_;
+                }
+            }
+
+        private:
+            hash_ctrl const *ctrl_;
+            Value *slot_;
+        };
+
+        template <class Left, class Right>
+        bool operator==(hash_map_iterator<Left> const &left,
+                        hash_map_iterator<Right> const &right)
+        {
+            return left.ctrl() == right.ctrl();
+        }
+
+        template <class Left, class Right>
+        bool operator!=(hash_map_iterator<Left> const &left,
+                        hash_map_iterator<Right> const &right)
+        {
+            return left.ctrl() != right.ctrl();
+        }
+    }
+
+    // An unordered map with open addressing in the style of a Swiss table.
+    // Values are stored in one contiguous array of slots, and a parallel
+    // array of control bytes holds seven bits of the hash of each key. A
+    // lookup matches a whole group of control bytes at once with vector
+    // compares, and only compares keys whose bits match, so it usually
+    // touches one control group and one slot. Groups are probed
+    // quadratically, and the map grows at a load of 7/8.
+    //
+    // Inserting may move all values, and invalidates iterators, pointers and
+    // references. Erasing only invalidates those to the erased value.
+    template <
+        class Key,
+        class Data,
+        class Hash = std::tr1::hash<Key>,
+        class Pred = std::equal_to<Key>,
+        class Allocator = std::allocator<std::pair<Key, Data> >
+    >
+    class hash_map {
+    public:
+        typedef Key key_type;
+        typedef Data data_type;
+        typedef std::pair<key_type, data_type> value_type;
+        typedef Hash hasher;
+        typedef Pred key_equal;
+        typedef typename Allocator::template rebind<value_type>::other
+            allocator_type;
+
+        typedef typename allocator_type::pointer pointer;
+        typedef typename allocator_type::reference reference;
+        typedef typename allocator_type::const_reference const_reference;
+        typedef std::size_t size_type;
+        typedef detail::hash_map_iterator<value_type> iterator;
+        typedef detail::hash_map_iterator<value_type const> const_iterator;
+
+        explicit hash_map(hasher const &hash = hasher(),
+                          key_equal const &eq = key_equal(),
+                          allocator_type const &allocator = allocator_type()) :
+            hash_(hash),
+            eq_(eq),
+            allocator_(allocator),
+            ctrl_(detail::empty_hash_ctrl()),
+            slots_(0),
+            capacity_(0),
+            size_(0),
+            growth_left_(0)
+        { }
+
+        template <class InputIterator>
+        hash_map(InputIterator first, InputIterator last,
+                 hasher const &hash = hasher(),
+                 key_equal const &eq = key_equal(),
+                 allocator_type const &allocator = allocator_type()) :
+            hash_(hash),
+            eq_(eq),
+            allocator_(allocator),
+            ctrl_(detail::empty_hash_ctrl()),
+            slots_(0),
+            capacity_(0),
+            size_(0),
+            growth_left_(0)
+        {
+            try {
+                insert(first, last);
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+
+        hash_map(hash_map const &other) :
+            hash_(other.hash_),
+            eq_(other.eq_),
+            allocator_(other.allocator_),
+            ctrl_(detail::empty_hash_ctrl()),
+            slots_(0),
+            capacity_(0),
+            size_(0),
+            growth_left_(0)
+        {
+            try {
+                reserve(other.size());
+                insert(other.begin(), other.end());
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+
+        ~hash_map()
+        {
+            release();
+        }
+
+        hash_map &operator=(hash_map const &other)
+        {
+            hash_map temp(other);
+            swap(temp);
+            return *this;
+        }
+
+        allocator_type get_allocator() const
+        {
+            return allocator_;
+        }
+
+        hasher hash_function() const
+        {
+            return hash_;
+        }
+
+        key_equal key_eq() const
+        {
+            return eq_;
+        }
+
+        iterator begin()
+        {
+            iterator i(ctrl_, slots_);
+            i.skip_free();
+            return i;
+        }
+
+        const_iterator begin() const
+        {
+            const_iterator i(ctrl_, slots_);
+            i.skip_free();
+            return i;
+        }
+
+        iterator end()
+        {
+            return iterator(ctrl_ + capacity_, slots_ + capacity_);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(ctrl_ + capacity_, slots_ + capacity_);
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        size_type size() const
+        {
+            return size_;
+        }
+
+        size_type max_size() const
+        {
+            return allocator_.max_size();
+        }
+
+        // The number of slots.
+        size_type capacity() const
+        {
+            return capacity_;
+        }
+
+        // Makes room for n values without growing again.
+        //
+        // Exception safety: Strong guarantee.
+        void reserve(size_type n)
+        {
+            if (n > max_load(capacity_)) {
+                size_type capacity = min_capacity;
+                while (max_load(capacity) < n) {
+                    capacity *= 2;
+                }
+                rehash(capacity);
+            }
+        }
+
+        data_type &operator[](key_type const &key)
+        {
+            return insert(value_type(key, data_type())).first->second;
+        }
+
+        // Exception safety: Strong guarantee.
+        std::pair<iterator, bool> insert(value_type const &value)
+        {
+            std::size_t hash = hash_key(value.first);
+            size_type i = find_index(value.first, hash);
+            if (i != capacity_) {
+                return std::make_pair(iterator(ctrl_ + i, slots_ + i), false);
+            }
+            i = capacity_ != 0 ? find_free(hash) : 0;
+            if (growth_left_ == 0 &&
+                (capacity_ == 0 || ctrl_[i] != detail::ctrl_deleted))
+            {
+                rehash(size_ < max_load(capacity_) / 2 ? capacity_ :
+                       std::max(2 * capacity_, size_type(min_capacity)));
+                i = find_free(hash);
+            }
+            allocator_.construct(slots_ + i, value);
+            growth_left_ -= (ctrl_[i] == detail::ctrl_empty);
+            ctrl_[i] = h2(hash);
+            ++size_;
+            return std::make_pair(iterator(ctrl_ + i, slots_ + i), true);
+        }
+
+        // Exception safety: Basic guarantee.
+        template <class InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        // Exception safety: No-throw guarantee.
+        void erase(const_iterator position)
+        {
+            size_type i = position.ctrl() - ctrl_;
+            allocator_.destroy(slots_ + i);
+            --size_;
+
+            // Probes stop at a group with an empty slot, so the slot can be
+            // emptied if its group has one. Otherwise, it must stay deleted
+            // for probes to continue past it.
+            size_type first = i / group_type::width * group_type::width;
+            if (group_type(ctrl_ + first).match_empty().any()) {
+                ctrl_[i] = detail::ctrl_empty;
+                ++growth_left_;
+            } else {
+                ctrl_[i] = detail::ctrl_deleted;
+            }
+        }
+
+        size_type erase(key_type const &key)
+        {
+            iterator i = find(key);
+            if (i == end()) {
+                return 0;
+            }
+            erase(i);
+            return 1;
+        }
+
+        // Exception safety: No-throw guarantee.
+        void swap(hash_map &other)
+        {
+            std::swap(hash_, other.hash_);
+            std::swap(eq_, other.eq_);
+            std::swap(allocator_, other.allocator_);
+            std::swap(ctrl_, other.ctrl_);
+            std::swap(slots_, other.slots_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(size_, other.size_);
+            std::swap(growth_left_, other.growth_left_);
+        }
+
+        // Keeps the slots for reuse.
+        //
+        // Exception safety: No-throw guarantee.
+        void clear()
+        {
+            if (size_ != 0) {
+                destroy_all();
+                reset_ctrl(ctrl_, capacity_);
+                size_ = 0;
+                growth_left_ = max_load(capacity_);
+            }
+        }
+
+        iterator find(key_type const &key)
+        {
+            size_type i = find_index(key, hash_key(key));
+            return iterator(ctrl_ + i, slots_ + i);
+        }
+
+        const_iterator find(key_type const &key) const
+        {
+            size_type i = find_index(key, hash_key(key));
+            return const_iterator(ctrl_ + i, slots_ + i);
+        }
+
+        size_type count(key_type const &key) const
+        {
+            return find_index(key, hash_key(key)) != capacity_;
+        }
+
+    private:
+        typedef detail::hash_group group_type;
+        typedef typename allocator_type::template rebind<detail::hash_ctrl>::
+            other ctrl_allocator_type;
+
+        enum { min_capacity = 4 };
+
+        hasher hash_;
+        key_equal eq_;
+        allocator_type allocator_;
+        detail::hash_ctrl *ctrl_;
+        value_type *slots_;
+        size_type capacity_;
+        size_type size_;
+        size_type growth_left_;
+
+        // The capacity is a power of two. Small maps have a single, partial
+        // group.
+        static size_type max_load(size_type capacity)
+        {
+            return capacity < 8 ? capacity - (capacity != 0) :
+                capacity - capacity / 8;
+        }
+
+        static size_type ctrl_size(size_type capacity)
+        {
+            return std::max(capacity, size_type(group_type::width)) + 1;
+        }
+
+        static void reset_ctrl(detail::hash_ctrl *ctrl, size_type capacity)
+        {
+            std::memset(ctrl, detail::ctrl_empty, capacity);
+            std::memset(ctrl + capacity, detail::ctrl_sentinel,
+                        ctrl_size(capacity) - capacity);
+        }
+
+        // Spreads the hash over all bits, so that hashes that only differ
+        // in their high bits, such as those of pointers, still use different
+        // groups and control bytes.
+        std::size_t hash_key(key_type const &key) const
+        {
+            return std::size_t(detail::hash_mix(
+                hash_(key), 0x9e3779b97f4a7c15ull));
+        }
+
+        static detail::hash_ctrl h2(std::size_t hash)
+        {
+            return detail::hash_ctrl(hash & 0x7f);
+        }
+
+        size_type group_count() const
+        {
+            return std::max(capacity_ / group_type::width, size_type(1));
+        }
+
+        // Returns the index of the key, or the capacity if there is none.
+        size_type find_index(key_type const &key, std::size_t hash) const
+        {
+            if (size_ == 0) {
+                return capacity_;
+            }
+            size_type mask = group_count() - 1;
+            size_type group = (hash >> 7) & mask;
+            for (size_type step = 1; ; ++step) {
+                size_type first = group * group_type::width;
+                group_type g(ctrl_ + first);
+                for (typename group_type::mask_type m = g.match(h2(hash));
+                     m.any(); m.clear_lowest())
+                {
+                    size_type i = first + m.lowest();
+                    if (eq_(slots_[i].first, key)) {
+                        return i;
+                    }
+                }
+                if (g.match_empty().any()) {
+                    return capacity_;
+                }
+                group = (group + step) & mask;
+            }
+        }
+
+        // Returns the index of the first empty or deleted slot on the probe
+        // sequence of the hash.
+        size_type find_free(std::size_t hash) const
+        {
+            size_type mask = group_count() - 1;
+            size_type group = (hash >> 7) & mask;
+            for (size_type step = 1; ; ++step) {
+                size_type first = group * group_type::width;
+                typename group_type::mask_type m =
+                    group_type(ctrl_ + first).match_empty_or_deleted();
+                if (m.any()) {
+                    return first + m.lowest();
+                }
+                group = (group + step) & mask;
+            }
+        }
+
+        // Moves the values to new slots. If a move throws, the new slots are
+        // released and the map is left unchanged.
+        //
+        // Exception safety: Strong guarantee.
+        void rehash(size_type capacity)
+        {
+            ctrl_allocator_type ctrl_allocator(allocator_);
+            hash_map temp(hash_, eq_, allocator_);
+            temp.ctrl_ = ctrl_allocator.allocate(ctrl_size(capacity));
+            try {
+                temp.slots_ = allocator_.allocate(capacity);
+            } catch (...) {
+                ctrl_allocator.deallocate(temp.ctrl_, ctrl_size(capacity));
+                temp.ctrl_ = detail::empty_hash_ctrl();
+                throw;
+            }
+            temp.capacity_ = capacity;
+            reset_ctrl(temp.ctrl_, capacity);
+            temp.growth_left_ = max_load(capacity) - size_;
+            for (size_type i = 0; i != capacity_; ++i) {
+                if (ctrl_[i] >= 0) {
+                    std::size_t hash = hash_key(slots_[i].first);
+                    size_type j = temp.find_free(hash);
+                    detail::relocate_construct(allocator_, slots_ + i,
+                                               slots_ + i + 1,
+                                               temp.slots_ + j);
+                    temp.ctrl_[j] = h2(hash);
+                    ++temp.size_;
+                }
+            }
+            for (size_type i = 0; i != capacity_; ++i) {
+                if (ctrl_[i] >= 0) {
+                    detail::relocate_destroy(allocator_, slots_ + i,
+                                             slots_ + i + 1);
+                }
+            }
+            size_ = 0;
+            swap(temp);
+        }
+
+        void destroy_all()
+        {
+            for (size_type i = 0; i != capacity_; ++i) {
+                if (ctrl_[i] >= 0) {
+                    allocator_.destroy(slots_ + i);
+                }
+            }
+        }
+
+        void release()
+        {
+            if (capacity_ != 0) {
+                if (size_ != 0) {
+                    destroy_all();
+                }
+                ctrl_allocator_type ctrl_allocator(allocator_);
+                ctrl_allocator.deallocate(ctrl_, ctrl_size(capacity_));
+                allocator_.deallocate(slots_, capacity_);
+            }
+        }
+    };
+}
+
+namespace std {
+    template <class K, class D, class H, class P, class A>
+    void swap(elemel::hash_map<K, D, H, P, A> &left,
+              elemel::hash_map<K, D, H, P, A> &right)
+    {
+        left.swap(right);
+    }
+}
+
+#endif // ELEMEL_HASH_MAP_HPP
@@ -21,28 +21,197 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <elemel/string_range.hpp>
+
 #include <cstddef>
+#include <cstring>
+#include <tr1/functional>
 
 namespace elemel {
-    std::size_t hash_string(unsigned char const *arg)
+    namespace detail {
+        typedef unsigned long long hash_word;
+
+        // Replaces a and b with the low and high halves of their 128-bit
+        // product.
+        inline void hash_multiply(hash_word &a, hash_word &b)
+        {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 product = (unsigned __int128)(a) * b;
+            a = hash_word(product);
+            b = hash_word(product >> 64);
+#else
+            hash_word a_high = a >> 32;
+            hash_word a_low = a & 0xffffffffull;
+            hash_word b_high = b >> 32;
+            hash_word b_low = b & 0xffffffffull;
+            hash_word middle1 = a_high * b_low;
+            hash_word middle2 = a_low * b_high;
+            hash_word low = a_low * b_low;
+            hash_word t = low + (middle1 << 32);
+            hash_word carry = t < low;
+            a = t + (middle2 << 32);
+            carry += a < t;
+            b = a_high * b_high + (middle1 >> 32) + (middle2 >> 32) + carry;
+#endif
+        }
+
+        inline hash_word hash_mix(hash_word a, hash_word b)
+        {
+            hash_multiply(a, b);
+            return a ^ b;
+        }
+
+        inline hash_word hash_read8(unsigned char const *p)
+        {
+            hash_word result;
+            std::memcpy(&result, p, 8);
+            return result;
+        }
+
+        inline hash_word hash_read4(unsigned char const *p)
+        {
+            unsigned int result;
+            std::memcpy(&result, p, 4);
+            return result;
+        }
+
+        // Reads one to three bytes.
+        inline hash_word hash_read3(unsigned char const *p, std::size_t n)
+        {
+            return ((hash_word(p[0]) << 16) | (hash_word(p[n >> 1]) << 8) |
+                    p[n - 1]);
+        }
+
+    }
+
+    // Hashes n bytes with a seeded 64-bit hash in the style of wyhash. Keys
+    // of up to 16 bytes are read with overlapping loads, and longer keys are
+    // consumed 16 or 48 bytes per step, with one 128-bit multiply for each 16
+    // bytes.
+    inline unsigned long long hash_bytes(void const *data, std::size_t n,
+                                         unsigned long long seed = 0)
     {
-        std::size_t result = 5381;
-        while (std::size_t c = *arg++) {
-            result = ((result << 5) + result) ^ c;
+        using detail::hash_mix;
+        using detail::hash_multiply;
+        using detail::hash_read3;
+        using detail::hash_read4;
+        using detail::hash_read8;
+        using detail::hash_word;
+
+        static hash_word const secret[4] = {
+            0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+            0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+        };
+
+        unsigned char const *p = static_cast<unsigned char const *>(data);
+        seed ^= hash_mix(seed ^ secret[0], secret[1]);
+        hash_word a;
+        hash_word b;
+        if (n <= 16) {
+            if (n >= 4) {
+                std::size_t offset = (n >> 3) << 2;
+                a = (hash_read4(p) << 32) | hash_read4(p + offset);
+                b = ((hash_read4(p + n - 4) << 32) |
+                     hash_read4(p + n - 4 - offset));
+            } else if (n > 0) {
+                a = hash_read3(p, n);
+                b = 0;
+            } else {
+                a = 0;
+                b = 0;
+            }
+        } else {
+            std::size_t i = n;
+            if (i > 48) {
+                hash_word seed1 = seed;
+                hash_word seed2 = seed;
+                do {
+                    seed = hash_mix(hash_read8(p) ^ secret[1],
+                                    hash_read8(p + 8) ^ seed);
+                    seed1 = hash_mix(hash_read8(p + 16) ^ secret[2],
+                                     hash_read8(p + 24) ^ seed1);
+                    seed2 = hash_mix(hash_read8(p + 32) ^ secret[3],
+                                     hash_read8(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (i > 16) {
+                seed = hash_mix(hash_read8(p) ^ secret[1],
+                                hash_read8(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            a = hash_read8(p + i - 16);
+            b = hash_read8(p + i - 8);
         }
-        return result;
+        a ^= secret[1];
+        b ^= seed;
+        hash_multiply(a, b);
+        return hash_mix(a ^ secret[0] ^ hash_word(n), b ^ secret[1]);
+    }
+
+    // Hashes the characters in [first, last) with hash_bytes().
+    template <class Char>
+    std::size_t hash_string(Char const *first, Char const *last,
+                            unsigned long long seed = 0)
+    {
+        return std::size_t(hash_bytes(first, (last - first) * sizeof(Char),
+                                      seed));
+    }
+
+    template <class Char>
+    std::size_t hash_string(Char const *str, std::size_t n,
+                            unsigned long long seed = 0)
+    {
+        return hash_string(str, str + n, seed);
     }
 
-    inline std::size_t hash_string(char const *arg)
+    template <class Char, class Traits>
+    std::size_t hash_string(basic_string_range<Char, Traits> const &range,
+                            unsigned long long seed = 0)
     {
-        return hash_string(reinterpret_cast<unsigned char const *>(arg));
+        return hash_string(range.begin(), range.end(), seed);
     }
 
-    inline std::size_t hash_string(signed char const *arg)
+    // Hashes a terminated string. Gives the same result as for the
+    // characters without the terminator.
+    inline std::size_t hash_string(char const *str)
     {
-        return hash_string(reinterpret_cast<unsigned char const *>(arg));
+        return hash_string(str, str + std::strlen(str));
     }
 
+    inline std::size_t hash_string(unsigned char const *str)
+    {
+        return hash_string(reinterpret_cast<char const *>(str));
+    }
+
+    inline std::size_t hash_string(signed char const *str)
+    {
+        return hash_string(reinterpret_cast<char const *>(str));
+    }
+
+    inline std::size_t hash_string(wchar_t const *str)
+    {
+        return hash_string(str, str + std::char_traits<wchar_t>::length(str));
+    }
+}
+
+namespace std {
+    namespace tr1 {
+        // Hashes the characters with hash_string().
+        template <class C, class T>
+        struct hash<elemel::basic_string_range<C, T> > {
+            typedef elemel::basic_string_range<C, T> argument_type;
+            typedef size_t result_type;
+
+            size_t operator()(argument_type const &arg) const
+            {
+                return elemel::hash_string(arg);
+            }
+        };
+    }
 }
 
 #endif // ELEMEL_HASH_STRING_HPP
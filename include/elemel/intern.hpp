@@ -0,0 +1,192 @@
+#ifndef ELEMEL_INTERN_HPP
+#define ELEMEL_INTERN_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/const_string.hpp>
+#include <elemel/hash_string.hpp>
+#include <elemel/raw_allocator.hpp>
+#include <elemel/string_range.hpp>
+#include <elemel/detail/mutex.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace elemel {
+    namespace detail {
+        // A hash set of the interned strings of one string type. It is split
+        // into shards that are locked separately, so that threads seldom
+        // wait for each other.
+        template <class String>
+        class intern_table {
+        public:
+            typedef typename String::impl_type impl_type;
+            typedef typename String::range_type range_type;
+            typedef typename String::traits_type traits_type;
+            typedef typename String::raw_allocator_type raw_allocator_type;
+
+            // The table is never destroyed, so that interned strings stay
+            // valid during static destruction.
+            static intern_table &instance()
+            {
+                static intern_table *table = new intern_table;
+                return *table;
+            }
+
+            impl_type *intern(range_type const &range)
+            {
+                std::size_t hash = hash_string(range.begin(), range.end());
+                shard &s = shards_[hash % shard_count];
+                lock_guard<mutex> lock(s.mutex_);
+                return s.find_or_insert(range, hash / shard_count);
+            }
+
+        private:
+            enum { shard_count = 16 };
+
+            struct entry {
+                std::size_t hash;
+                impl_type *impl;
+            };
+
+            // An open addressing hash table with linear probing, which is
+            // kept at most half full.
+            class shard {
+            public:
+                mutex mutex_;
+
+                shard() :
+                    size_(0)
+                { }
+
+                impl_type *find_or_insert(range_type const &range,
+                                          std::size_t hash)
+                {
+                    if (2 * (size_ + 1) > slots_.size()) {
+                        grow();
+                    }
+                    std::size_t mask = slots_.size() - 1;
+                    for (std::size_t i = hash & mask; ; i = (i + 1) & mask) {
+                        entry &e = slots_[i];
+                        if (!e.impl) {
+                            e.impl = impl_type::create(range.data(),
+                                                       range.size(),
+                                                       alloc_.get());
+                            e.impl->mark_interned();
+                            e.hash = hash;
+                            ++size_;
+                            return e.impl;
+                        }
+                        if (e.hash == hash && e.impl->size() == range.size() &&
+                            std::equal(range.begin(), range.end(),
+                                       e.impl->data(), traits_type::eq))
+                        {
+                            return e.impl;
+                        }
+                    }
+                }
+
+            private:
+                std::vector<entry> slots_;
+                std::size_t size_;
+                permanent_raw_allocator<raw_allocator_type> alloc_;
+
+                void grow()
+                {
+                    entry empty = { 0, 0 };
+                    std::vector<entry> slots(std::max<std::size_t>(
+                                                 16, 2 * slots_.size()),
+                                             empty);
+                    std::size_t mask = slots.size() - 1;
+                    for (std::size_t i = 0; i != slots_.size(); ++i) {
+                        if (slots_[i].impl) {
+                            std::size_t j = slots_[i].hash & mask;
+                            while (slots[j].impl) {
+                                j = (j + 1) & mask;
+                            }
+                            slots[j] = slots_[i];
+                        }
+                    }
+                    slots_.swap(slots);
+                }
+            };
+
+            shard shards_[shard_count];
+        };
+    }
+
+    // Returns a string that shares its characters with every interned
+    // string that is equal to it. Equal interned strings then compare in
+    // constant time, by address. Interned strings are never freed, since
+    // their reference counts are made immortal. Their characters are
+    // allocated with permanent_raw_allocator, so that strings interned with
+    // an arena allocator outlive resets of the arena. Interning is safe from
+    // several threads, but threads that intern equal strings share them, so
+    // the strings then need an atomic or deferred RefCount. Strings that
+    // differ only in characters that the traits consider equal are interned
+    // separately, and compare by their characters.
+    template <class String>
+    String basic_intern(typename String::range_type const &range)
+    {
+        return String(detail::intern_table<String>::instance().intern(range));
+    }
+
+    inline const_string intern(string_range const &range)
+    {
+        return basic_intern<const_string>(range);
+    }
+
+    inline const_wstring intern(wstring_range const &range)
+    {
+        return basic_intern<const_wstring>(range);
+    }
+
+    template <class C, class T, class N, class A>
+    basic_const_string<C, T, N, A>
+    intern(basic_const_string<C, T, N, A> const &str)
+    {
+        typedef basic_const_string<C, T, N, A> string_type;
+
+        if (str.interned()) {
+            return str;
+        }
+        return basic_intern<string_type>(
+            typename string_type::range_type(str.data(), str.size()));
+    }
+
+    // Orders interned strings by address, which is much faster than
+    // comparing their characters. The order is arbitrary, but it is the same
+    // for as long as the program runs.
+    struct interned_less {
+        template <class String>
+        bool operator()(String const &left, String const &right) const
+        {
+            assert(left.interned() && right.interned());
+            return std::less<typename String::const_pointer>()(left.data(),
+                                                               right.data());
+        }
+    };
+}
+
+#endif // ELEMEL_INTERN_HPP
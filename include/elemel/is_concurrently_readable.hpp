@@ -0,0 +1,36 @@
+#ifndef ELEMEL_IS_CONCURRENTLY_READABLE_HPP
+#define ELEMEL_IS_CONCURRENTLY_READABLE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/type_traits.hpp>
+
+namespace elemel {
+    // Tells if a map can be read by several threads at once with its const
+    // member functions, and copied while others read it, without touching
+    // state that is shared with other maps. Concurrent containers require
+    // it of their storage. Specialize it as false for maps that change
+    // shared state on reads or copies.
+    template <class T>
+    struct is_concurrently_readable : detail::true_type { };
+}
+
+#endif // ELEMEL_IS_CONCURRENTLY_READABLE_HPP
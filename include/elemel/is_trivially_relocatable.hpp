@@ -0,0 +1,62 @@
+#ifndef ELEMEL_IS_TRIVIALLY_RELOCATABLE_HPP
+#define ELEMEL_IS_TRIVIALLY_RELOCATABLE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/type_traits.hpp>
+
+#include <utility>
+
+#if !defined(ELEMEL_NO_CXX11)
+#   include <type_traits>
+#endif
+
+namespace elemel {
+    // Tells if moving a value to new storage and destroying the original can
+    // be done by copying its bytes. Containers use this to grow and shift
+    // with memcpy and memmove. Specialize it for classes that do not point
+    // into themselves, such as classes that only hold reference counted
+    // pointers.
+    template <class T>
+    struct is_trivially_relocatable :
+#if !defined(ELEMEL_NO_CXX11)
+        detail::bool_constant<std::is_trivially_copy_constructible<T>::value &&
+                              std::is_trivially_destructible<T>::value>
+#elif defined(__GNUC__)
+        detail::bool_constant<__has_trivial_copy(T) &&
+                              __has_trivial_destructor(T)>
+#else
+        detail::is_arithmetic<T>
+#endif
+    { };
+
+    template <class T>
+    struct is_trivially_relocatable<T *> : detail::true_type { };
+
+    template <class First, class Second>
+    struct is_trivially_relocatable<std::pair<First, Second> > :
+        detail::bool_constant<is_trivially_relocatable<First>::value &&
+                              is_trivially_relocatable<Second>::value>
+    { };
+}
+
+#endif // ELEMEL_IS_TRIVIALLY_RELOCATABLE_HPP
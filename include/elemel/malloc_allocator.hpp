@@ -0,0 +1,137 @@
+#ifndef ELEMEL_MALLOC_ALLOCATOR_HPP
+#define ELEMEL_MALLOC_ALLOCATOR_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/relocate.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+namespace elemel {
+    // A standard allocator on top of std::malloc. It can also grow a block
+    // with std::realloc, which copying_vector uses for trivially relocatable
+    // values.
+    template <class T>
+    class malloc_allocator {
+    public:
+        typedef T value_type;
+        typedef T *pointer;
+        typedef T const *const_pointer;
+        typedef T &reference;
+        typedef T const &const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template <class U>
+        struct rebind {
+            typedef malloc_allocator<U> other;
+        };
+
+        malloc_allocator()
+        { }
+
+        template <class U>
+        malloc_allocator(malloc_allocator<U> const &other)
+        { }
+
+        pointer address(reference value) const
+        {
+            return &value;
+        }
+
+        const_pointer address(const_reference value) const
+        {
+            return &value;
+        }
+
+        pointer allocate(size_type n, void const *hint = 0)
+        {
+            void *p = std::malloc(n * sizeof(value_type));
+            if (p == 0 && n != 0) {
+                throw std::bad_alloc();
+            }
+            return static_cast<pointer>(p);
+        }
+
+        // Exception safety: Strong guarantee.
+        pointer reallocate(pointer p, size_type old_n, size_type new_n)
+        {
+            void *result = std::realloc(static_cast<void *>(p),
+                                        new_n * sizeof(value_type));
+            if (result == 0 && new_n != 0) {
+                throw std::bad_alloc();
+            }
+            return static_cast<pointer>(result);
+        }
+
+        void deallocate(pointer p, size_type n)
+        {
+            std::free(p);
+        }
+
+        size_type max_size() const
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(value_type);
+        }
+
+        void construct(pointer p, const_reference value)
+        {
+            new (static_cast<void *>(p)) value_type(value);
+        }
+
+#if !defined(ELEMEL_NO_CXX11)
+        template <class U, class... Args>
+        void construct(U *p, Args &&... args)
+        {
+            new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+        }
+#endif
+
+        void destroy(pointer p)
+        {
+            p->~value_type();
+        }
+    };
+
+    template <class T, class U>
+    bool operator==(malloc_allocator<T> const &left,
+                    malloc_allocator<U> const &right)
+    {
+        return true;
+    }
+
+    template <class T, class U>
+    bool operator!=(malloc_allocator<T> const &left,
+                    malloc_allocator<U> const &right)
+    {
+        return false;
+    }
+
+    namespace detail {
+        template <class T>
+        struct has_reallocate<malloc_allocator<T> > : true_type { };
+    }
+}
+
+#endif // ELEMEL_MALLOC_ALLOCATOR_HPP
@@ -21,6 +21,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <elemel/detail/type_traits.hpp>
+
 #include <functional>
 
 namespace elemel {
@@ -37,6 +39,15 @@ namespace elemel {
             return comp_(get_key(left), get_key(right));
         }
 
+        // Compares the keys in three ways. Only available if the key
+        // comparison supports it.
+        template <typename Left, typename Right>
+        int three_way(Left const &left, Right const &right) const
+        {
+            return detail::three_way_compare<Compare>::compare(
+                comp_, get_key(left), get_key(right));
+        }
+
     private:
         Compare comp_;
 
@@ -57,6 +68,20 @@ namespace elemel {
             return value.first;
         }
     };
+
+    namespace detail {
+        template <class Key, class Compare>
+        struct three_way_compare<map_pair_compare<Key, Compare> > :
+            three_way_compare<Compare>::type
+        {
+            template <class Left, class Right>
+            static int compare(map_pair_compare<Key, Compare> const &comp,
+                               Left const &left, Right const &right)
+            {
+                return comp.three_way(left, right);
+            }
+        };
+    }
 }
 
 #endif // ELEMEL_MAP_PAIR_COMPARE_HPP
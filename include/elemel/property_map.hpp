@@ -22,11 +22,27 @@
 // IN THE SOFTWARE.
 
 #include <elemel/flat_map.hpp>
+#include <elemel/ref_count.hpp>
 
 #include <iostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace elemel {
+    // A map of properties that inherits the properties of a prototype.
+    //
+    // A prototype caches the lookups that go through it. Each map has a
+    // version, which is drawn from a counter shared by all maps of the same
+    // type when the map is created and whenever a key is added or erased or
+    // the prototype changes. A cache or a lookup handle remembers the newest
+    // version in its prototype chain, and is stale once a map in the chain
+    // has a newer one. Edits only affect the chains that they are part of,
+    // and are checked lazily, by walking up the chain on lookup.
+    //
+    // A map that has stopped changing can be frozen. Freezing resolves all
+    // the keys of the map and its prototypes into one table, so that a get
+    // is a single lookup, and makes all the maps in the chain read-only.
     template <
         class Key,
         class Data,
@@ -44,24 +60,57 @@ namespace elemel {
         typedef typename storage_type::iterator iterator;
         typedef typename storage_type::const_iterator const_iterator;
 
+        // Remembers the result of looking up a key, for gets that repeat
+        // the lookup many times. A get with the handle only looks up the key
+        // again when it is used with another map, or when a map in the
+        // prototype chain has changed.
+        class lookup_handle {
+        public:
+            explicit lookup_handle(key_type const &key) :
+                key_(key),
+                map_(0),
+                version_(0),
+                result_(0)
+            { }
+
+            key_type const &key() const
+            {
+                return key_;
+            }
+
+        private:
+            friend class property_map;
+
+            key_type key_;
+            property_map const *map_;
+            long version_;
+            data_type const *result_;
+        };
+
         explicit property_map(property_map *prototype = 0) :
             prototype_(prototype),
-            first_instance_(0),
-            next_instance_(0),
-            previous_instance_(0)
+            version_(next_version()),
+            cache_version_(0),
+            frozen_(false)
         { }
 
         property_map(property_map const &other) :
             properties_(other.properties_),
             prototype_(other.prototype_),
-            first_instance_(0),
-            next_instance_(0),
-            previous_instance_(0)
+            version_(next_version()),
+            cache_version_(0),
+            frozen_(false)
         { }
 
-        ~property_map()
+        property_map &operator=(property_map const &other)
         {
-            unlink();
+            check_mutable();
+            if (this != &other) {
+                properties_ = other.properties_;
+                prototype_ = other.prototype_;
+                changed();
+            }
+            return *this;
         }
 
         property_map *prototype()
@@ -76,12 +125,16 @@ namespace elemel {
 
         void prototype(property_map *prototype)
         {
-            unlink();
+            check_mutable();
             prototype_ = prototype;
+            changed();
         }
 
         data_type const *get_ptr(key_type const &key) const
         {
+            if (frozen_) {
+                return find_frozen(key);
+            }
             const_iterator i = properties_.find(key);
             if (i != properties_.end()) {
                 return &i->second;
@@ -92,6 +145,17 @@ namespace elemel {
             }
         }
 
+        data_type const *get_ptr(lookup_handle &handle) const
+        {
+            long version = chain_version();
+            if (handle.map_ != this || handle.version_ < version) {
+                handle.result_ = get_ptr(handle.key_);
+                handle.map_ = this;
+                handle.version_ = version;
+            }
+            return handle.result_;
+        }
+
         data_type *get_local_ptr(key_type const &key)
         {
             iterator i = properties_.find(key);
@@ -113,6 +177,15 @@ namespace elemel {
             return *result;
         }
 
+        data_type const &get(lookup_handle &handle) const
+        {
+            data_type const *result = get_ptr(handle);
+            if (result == 0) {
+                throw std::out_of_range("no such key");
+            }
+            return *result;
+        }
+
         data_type &get_local(key_type const &key)
         {
             data_type *result = get_local_ptr(key);
@@ -133,10 +206,11 @@ namespace elemel {
 
         void set(key_type const &key, data_type const &value)
         {
+            check_mutable();
             iterator i = properties_.find(key);
             if (i == properties_.end()) {
-                unlink();
                 properties_.insert(std::make_pair(key, value));
+                changed();
             } else {
                 i->second = value;
             }
@@ -144,16 +218,54 @@ namespace elemel {
 
         size_type erase(key_type const &key)
         {
+            check_mutable();
             iterator i = properties_.find(key);
             if (i == properties_.end()) {
                 return 0;
             } else {
-                unlink();
                 properties_.erase(i);
+                changed();
                 return 1;
             }
         }
 
+        // Freezes the prototypes, and resolves the keys of this map and its
+        // prototypes into the cache, with local values first. set(),
+        // erase(), prototype() and assignment then throw std::logic_error.
+        //
+        // Exception safety: Basic guarantee. The prototypes stay frozen if
+        // freezing this map fails.
+        void freeze()
+        {
+            if (frozen_) {
+                return;
+            }
+            if (prototype_) {
+                prototype_->freeze();
+            }
+
+            std::vector<std::pair<key_type, data_type const *> > local;
+            local.reserve(properties_.size());
+            for (const_iterator i = properties_.begin();
+                 i != properties_.end(); ++i)
+            {
+                local.push_back(std::make_pair(i->first, &i->second));
+            }
+            cache_type table;
+            table.insert(local.begin(), local.end());
+            if (prototype_) {
+                table.insert(prototype_->cache_.begin(),
+                             prototype_->cache_.end());
+            }
+            cache_.swap(table);
+            frozen_ = true;
+        }
+
+        bool frozen() const
+        {
+            return frozen_;
+        }
+
         bool empty() const
         {
             return properties_.empty();
@@ -187,53 +299,67 @@ namespace elemel {
     private:
         storage_type properties_;
         property_map *prototype_;
-
-        property_map *first_instance_;
-        property_map *next_instance_;
-        property_map *previous_instance_;
+        long version_;
+        long cache_version_;
+        bool frozen_;
         cache_type cache_;
 
-        void link()
+        // Versions are unique, so that a map created at the address of a
+        // destroyed one does not match its handles.
+        static long next_version()
         {
-            if (prototype_ && next_instance_ == 0) {
-                if (prototype_->first_instance_ == 0) {
-                    prototype_->first_instance_ = this;
-                    next_instance_ = this;
-                    previous_instance_ = this;
-                } else {
-                    previous_instance_ = prototype_->first_instance_->previous_instance_;
-                    next_instance_ = prototype_->first_instance_;
-                    prototype_->first_instance_->previous_instance_->next_instance_ = this;
-                    prototype_->first_instance_->previous_instance_ = this;
+            static detail::atomic_long versions;
+            return versions.add_relaxed(1);
+        }
+
+        // The newest version in the prototype chain. The walk stops at the
+        // first frozen map, since the rest of the chain is frozen too.
+        long chain_version() const
+        {
+            long result = 0;
+            for (property_map const *map = this; map; map = map->prototype_) {
+                if (result < map->version_) {
+                    result = map->version_;
+                }
+                if (map->frozen_) {
+                    break;
                 }
             }
+            return result;
         }
 
-        void unlink()
+        void check_mutable() const
         {
-            while (first_instance_) {
-                first_instance_->previous_instance_->unlink();
+            if (frozen_) {
+                throw std::logic_error("property map is frozen");
             }
+        }
 
-            cache_.clear();
-
-            if (next_instance_) {
-                if (next_instance_ == this) {
-                    prototype_->first_instance_ = 0;
-                } else {
-                    if (prototype_->first_instance_ = this) {
-                        prototype_->first_instance_ = next_instance_;
-                    }
-                    next_instance_->previous_instance_ = previous_instance_;
-                    previous_instance_->next_instance_ = next_instance_;
-                }
-                next_instance_ = 0;
-                previous_instance_ = 0;
-            }
+        data_type const *find_frozen(key_type const &key) const
+        {
+            typename cache_type::const_iterator i = cache_.find(key);
+            return (i != cache_.end()) ? i->second : 0;
+        }
+
+        // Adding or erasing a key may move the values, so the pointers in
+        // the caches of this map and the maps that inherit from it must go.
+        void changed()
+        {
+            version_ = next_version();
         }
 
         data_type const *inherit(key_type const &key)
         {
+            if (frozen_) {
+                return find_frozen(key);
+            }
+
+            long version = chain_version();
+            if (cache_version_ < version) {
+                cache_.clear();
+                cache_version_ = version;
+            }
+
             typename cache_type::const_iterator i = cache_.find(key);
             if (i != cache_.end()) {
                 return i->second;
@@ -244,7 +370,6 @@ namespace elemel {
             if (j != properties_.end()) {
                 result = &j->second;
             } else if (prototype_) {
-                link();
                 result = prototype_->inherit(key);
             }
             cache_.insert(std::make_pair(key, result));
@@ -1,8 +1,12 @@
 #ifndef ELEMEL_RAW_ALLOCATOR_HPP
 #define ELEMEL_RAW_ALLOCATOR_HPP
 
+#include <elemel/detail/config.hpp>
+#include <elemel/detail/pool.hpp>
+
 #include <cstddef>
 #include <cstdlib>
+#include <new>
 
 namespace elemel {
     class raw_new_allocator {
@@ -34,6 +38,263 @@ namespace elemel {
             std::free(p);
         }
     };
+
+    inline bool operator==(raw_new_allocator const &left,
+                           raw_new_allocator const &right)
+    {
+        return true;
+    }
+
+    inline bool operator!=(raw_new_allocator const &left,
+                           raw_new_allocator const &right)
+    {
+        return false;
+    }
+
+    inline bool operator==(raw_malloc_allocator const &left,
+                           raw_malloc_allocator const &right)
+    {
+        return true;
+    }
+
+    inline bool operator!=(raw_malloc_allocator const &left,
+                           raw_malloc_allocator const &right)
+    {
+        return false;
+    }
+
+    // Hands out memory from large chunks by bumping a pointer. Allocations
+    // are not freed one by one. Instead, reset() frees them all at once. An
+    // arena must only be used by one thread at a time.
+    class arena {
+    public:
+        typedef std::size_t size_type;
+
+        // Allocations are aligned for any fundamental type.
+        enum { alignment = 16 };
+
+        explicit arena(size_type chunk_size = 64 * 1024) :
+            chunk_size_(chunk_size),
+            chunks_(0),
+            position_(0),
+            end_(0)
+        { }
+
+        ~arena()
+        {
+            release(chunks_);
+        }
+
+        void *allocate(size_type n)
+        {
+            n = (n + alignment - 1) & ~size_type(alignment - 1);
+            if (size_type(end_ - position_) < n) {
+                return allocate_chunk(n);
+            }
+            void *result = position_;
+            position_ += n;
+            return result;
+        }
+
+        // Frees all allocations. The last chunk is kept for reuse.
+        void reset()
+        {
+            if (chunks_) {
+                release(chunks_->next);
+                chunks_->next = 0;
+                position_ = chunks_->data();
+                end_ = position_ + chunks_->size;
+            }
+        }
+
+    private:
+        struct chunk {
+            chunk *next;
+            size_type size;
+
+            char *data()
+            {
+                return reinterpret_cast<char *>(this) + header_size;
+            }
+        };
+
+        enum {
+            header_size = ((sizeof(chunk) + alignment - 1) &
+                           ~std::size_t(alignment - 1))
+        };
+
+        size_type chunk_size_;
+        chunk *chunks_;
+        char *position_;
+        char *end_;
+
+        arena(arena const &other);
+        arena &operator=(arena const &other);
+
+        void *allocate_chunk(size_type n)
+        {
+            if (chunks_ && n > chunk_size_ / 4) {
+                // Large allocations get a chunk of their own, behind the
+                // current one.
+                chunk *c = new_chunk(n);
+                c->next = chunks_->next;
+                chunks_->next = c;
+                return c->data();
+            }
+            chunk *c = new_chunk(n < chunk_size_ ? chunk_size_ : n);
+            c->next = chunks_;
+            chunks_ = c;
+            position_ = c->data() + n;
+            end_ = c->data() + c->size;
+            return c->data();
+        }
+
+        static chunk *new_chunk(size_type n)
+        {
+            chunk *c = static_cast<chunk *>(::operator new(header_size + n));
+            c->next = 0;
+            c->size = n;
+            return c;
+        }
+
+        static void release(chunk *c)
+        {
+            while (c) {
+                chunk *next = c->next;
+                ::operator delete(static_cast<void *>(c));
+                c = next;
+            }
+        }
+    };
+
+    // The arena of the calling thread. It lives until the thread exits.
+    inline arena &thread_arena()
+    {
+#if !defined(ELEMEL_NO_CXX11)
+        static thread_local arena instance;
+        return instance;
+#else
+        // Without thread_local, the arena of a thread is never destroyed.
+        static __thread arena *instance = 0;
+        if (!instance) {
+            instance = new arena;
+        }
+        return *instance;
+#endif
+    }
+
+    // Allocates from an arena, by default the arena of the calling thread.
+    // deallocate() does nothing. The memory is reclaimed when the arena is
+    // reset or destroyed, and strings allocated from it must not outlive
+    // that.
+    class raw_arena_allocator {
+    public:
+        typedef std::size_t size_type;
+
+        raw_arena_allocator() :
+            arena_(&thread_arena())
+        { }
+
+        explicit raw_arena_allocator(arena &a) :
+            arena_(&a)
+        { }
+
+        void *allocate(size_type n) const
+        {
+            return arena_->allocate(n);
+        }
+
+        void deallocate(void *p) const
+        { }
+
+        arena &get_arena() const
+        {
+            return *arena_;
+        }
+
+    private:
+        arena *arena_;
+    };
+
+    inline bool operator==(raw_arena_allocator const &left,
+                           raw_arena_allocator const &right)
+    {
+        return &left.get_arena() == &right.get_arena();
+    }
+
+    inline bool operator!=(raw_arena_allocator const &left,
+                           raw_arena_allocator const &right)
+    {
+        return !(left == right);
+    }
+
+    // Allocates small blocks from size classes that fit string headers and
+    // short payloads. Freed blocks are cached by the calling thread and
+    // handed back to a shared depot in batches, so the global heap is only
+    // hit for blocks of more than 4 KB, or when the pool needs more memory.
+    // Pooled memory is never returned to the heap.
+    class raw_pool_allocator {
+    public:
+        typedef std::size_t size_type;
+
+        void *allocate(size_type n) const
+        {
+            return detail::pool_allocate(n);
+        }
+
+        void deallocate(void *p) const
+        {
+            detail::pool_deallocate(p);
+        }
+    };
+
+    inline bool operator==(raw_pool_allocator const &left,
+                           raw_pool_allocator const &right)
+    {
+        return true;
+    }
+
+    inline bool operator!=(raw_pool_allocator const &left,
+                           raw_pool_allocator const &right)
+    {
+        return false;
+    }
+
+    // Makes allocators for memory that must stay valid for as long as the
+    // program runs, such as that of interned strings. By default, they are
+    // default-constructed. Allocators whose memory is reclaimed all at once
+    // specialize it.
+    template <class RawAllocator>
+    class permanent_raw_allocator {
+    public:
+        RawAllocator get()
+        {
+            return RawAllocator();
+        }
+    };
+
+    // Allocates from an arena of its own, which is never reset or
+    // destroyed. Like the arena, it must only be used by one thread at a
+    // time.
+    template <>
+    class permanent_raw_allocator<raw_arena_allocator> {
+    public:
+        permanent_raw_allocator() :
+            arena_(new arena)
+        { }
+
+        raw_arena_allocator get()
+        {
+            return raw_arena_allocator(*arena_);
+        }
+
+    private:
+        arena *arena_;
+
+        permanent_raw_allocator(permanent_raw_allocator const &other);
+        permanent_raw_allocator &operator=(
+            permanent_raw_allocator const &other);
+    };
 }
 
 #endif // ELEMEL_RAW_ALLOCATOR_HPP
@@ -0,0 +1,136 @@
+#ifndef ELEMEL_RAW_ALLOCATOR_ADAPTER_HPP
+#define ELEMEL_RAW_ALLOCATOR_ADAPTER_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/raw_allocator.hpp>
+#include <elemel/detail/config.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace elemel {
+    // A standard allocator on top of a raw allocator, so that containers
+    // such as copying_vector and flat_map can share an arena or a pool with
+    // strings.
+    template <class T, class RawAllocator = raw_new_allocator>
+    class raw_allocator_adapter {
+    public:
+        typedef T value_type;
+        typedef T *pointer;
+        typedef T const *const_pointer;
+        typedef T &reference;
+        typedef T const &const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef RawAllocator raw_allocator_type;
+
+        template <class U>
+        struct rebind {
+            typedef raw_allocator_adapter<U, raw_allocator_type> other;
+        };
+
+        explicit raw_allocator_adapter(raw_allocator_type const &alloc =
+                                       raw_allocator_type()) :
+            alloc_(alloc)
+        { }
+
+        template <class U>
+        raw_allocator_adapter(raw_allocator_adapter<U, raw_allocator_type> const &other) :
+            alloc_(other.raw_allocator())
+        { }
+
+        raw_allocator_type raw_allocator() const
+        {
+            return alloc_;
+        }
+
+        pointer address(reference value) const
+        {
+            return &value;
+        }
+
+        const_pointer address(const_reference value) const
+        {
+            return &value;
+        }
+
+        pointer allocate(size_type n, void const *hint = 0)
+        {
+            if (n > max_size()) {
+                throw std::bad_alloc();
+            }
+            void *p = alloc_.allocate(n * sizeof(value_type));
+            if (p == 0 && n != 0) {
+                throw std::bad_alloc();
+            }
+            return static_cast<pointer>(p);
+        }
+
+        void deallocate(pointer p, size_type n)
+        {
+            alloc_.deallocate(static_cast<void *>(p));
+        }
+
+        size_type max_size() const
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(value_type);
+        }
+
+        void construct(pointer p, const_reference value)
+        {
+            new (static_cast<void *>(p)) value_type(value);
+        }
+
+#if !defined(ELEMEL_NO_CXX11)
+        template <class U, class... Args>
+        void construct(U *p, Args &&... args)
+        {
+            new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+        }
+#endif
+
+        void destroy(pointer p)
+        {
+            p->~value_type();
+        }
+
+    private:
+        raw_allocator_type alloc_;
+    };
+
+    template <class T, class U, class A>
+    bool operator==(raw_allocator_adapter<T, A> const &left,
+                    raw_allocator_adapter<U, A> const &right)
+    {
+        return left.raw_allocator() == right.raw_allocator();
+    }
+
+    template <class T, class U, class A>
+    bool operator!=(raw_allocator_adapter<T, A> const &left,
+                    raw_allocator_adapter<U, A> const &right)
+    {
+        return !(left == right);
+    }
+}
+
+#endif // ELEMEL_RAW_ALLOCATOR_ADAPTER_HPP
@@ -0,0 +1,221 @@
+#ifndef ELEMEL_REF_COUNT_HPP
+#define ELEMEL_REF_COUNT_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/detail/config.hpp>
+
+#include <climits>
+#include <limits>
+
+#if !defined(ELEMEL_NO_CXX11)
+#include <atomic>
+#elif !defined(__GNUC__)
+#error "Atomic reference counts need C++11 or GCC atomic builtins."
+#endif
+
+// Reference count policies for the RefCount parameter of the string
+// classes. A plain integer type such as long is the fastest, but cannot be
+// shared between threads.
+
+namespace elemel {
+    namespace detail {
+        // A count that releases never bring down to zero.
+        long const immortal_ref_count = LONG_MAX / 2;
+
+        // A long that is accessed atomically, with the given memory order
+        // for each access.
+        class atomic_long {
+        public:
+            explicit atomic_long(long value = 0) :
+                value_(value)
+            { }
+
+#if !defined(ELEMEL_NO_CXX11)
+            long load_relaxed() const
+            {
+                return value_.load(std::memory_order_relaxed);
+            }
+
+            void store_relaxed(long value)
+            {
+                value_.store(value, std::memory_order_relaxed);
+            }
+
+            long add_relaxed(long n)
+            {
+                return value_.fetch_add(n, std::memory_order_relaxed) + n;
+            }
+
+            long add_acq_rel(long n)
+            {
+                return value_.fetch_add(n, std::memory_order_acq_rel) + n;
+            }
+
+        private:
+            std::atomic<long> value_;
+#else
+            long load_relaxed() const
+            {
+                return __atomic_load_n(&value_, __ATOMIC_RELAXED);
+            }
+
+            void store_relaxed(long value)
+            {
+                __atomic_store_n(&value_, value, __ATOMIC_RELAXED);
+            }
+
+            long add_relaxed(long n)
+            {
+                return __atomic_add_fetch(&value_, n, __ATOMIC_RELAXED);
+            }
+
+            long add_acq_rel(long n)
+            {
+                return __atomic_add_fetch(&value_, n, __ATOMIC_ACQ_REL);
+            }
+
+        private:
+            long value_;
+
+            atomic_long(atomic_long const &other);
+            atomic_long &operator=(atomic_long const &other);
+#endif
+        };
+    }
+
+    // A reference count that can be shared between threads. Adding a
+    // reference is relaxed, since the adding thread already holds one.
+    // Releasing a reference orders the release of the last reference after
+    // all uses of the object, so that it can be destroyed safely.
+    class atomic_ref_count {
+    public:
+        explicit atomic_ref_count(long value = 0) :
+            value_(value)
+        { }
+
+        long operator++()
+        {
+            return value_.add_relaxed(1);
+        }
+
+        long operator--()
+        {
+            return value_.add_acq_rel(-1);
+        }
+
+        void make_immortal()
+        {
+            value_.store_relaxed(detail::immortal_ref_count);
+        }
+
+    private:
+        detail::atomic_long value_;
+    };
+
+    // A reference count that stays non-atomic while its object is used by a
+    // single thread. share() makes it atomic for good. It must be called
+    // before the object is handed to another thread, for example with the
+    // share() member function of a string.
+    class deferred_ref_count {
+    public:
+        explicit deferred_ref_count(long value = 0) :
+            value_(value),
+            shared_(false)
+        { }
+
+        long operator++()
+        {
+            if (shared_) {
+                return value_.add_relaxed(1);
+            } else {
+                long value = value_.load_relaxed() + 1;
+                value_.store_relaxed(value);
+                return value;
+            }
+        }
+
+        long operator--()
+        {
+            if (shared_) {
+                return value_.add_acq_rel(-1);
+            } else {
+                long value = value_.load_relaxed() - 1;
+                value_.store_relaxed(value);
+                return value;
+            }
+        }
+
+        // Only the thread that owns the object may call this. Handing the
+        // object to another thread then publishes the change.
+        void share()
+        {
+            shared_ = true;
+        }
+
+        bool shared() const
+        {
+            return shared_;
+        }
+
+        void make_immortal()
+        {
+            value_.store_relaxed(detail::immortal_ref_count);
+        }
+
+    private:
+        detail::atomic_long value_;
+        bool shared_;
+    };
+
+    // Prepares a reference count for use from several threads. Only
+    // deferred counts need this. Plain integer counts stay unsafe.
+    template <class RefCount>
+    void share_ref_count(RefCount &count)
+    { }
+
+    inline void share_ref_count(deferred_ref_count &count)
+    {
+        count.share();
+    }
+
+    // Raises a reference count so high that releases never bring it down to
+    // zero, for objects that are never freed, such as interned strings.
+    // Deferred counts are also shared, since such objects are.
+    template <class RefCount>
+    void make_ref_count_immortal(RefCount &count)
+    {
+        count = std::numeric_limits<RefCount>::max() / 2;
+    }
+
+    inline void make_ref_count_immortal(atomic_ref_count &count)
+    {
+        count.make_immortal();
+    }
+
+    inline void make_ref_count_immortal(deferred_ref_count &count)
+    {
+        count.share();
+        count.make_immortal();
+    }
+}
+
+#endif // ELEMEL_REF_COUNT_HPP
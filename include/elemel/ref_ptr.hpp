@@ -1,6 +1,8 @@
 #ifndef ELEMEL_REF_PTR_HPP
 #define ELEMEL_REF_PTR_HPP
 
+#include <elemel/is_trivially_relocatable.hpp>
+
 #include <algorithm>
 #include <cassert>
 
@@ -36,6 +38,7 @@ namespace elemel {
         ref_ptr &operator=(ref_ptr const &other)
         {
             ref_ptr(other).swap(*this);
+            return *this;
         }
 
         element_type &operator*() const
@@ -75,6 +78,9 @@ namespace elemel {
 
         operator int() const;
     };
+
+    template <class T>
+    struct is_trivially_relocatable<ref_ptr<T> > : detail::true_type { };
 }
 
 #endif // ELEMEL_REF_PTR_HPP
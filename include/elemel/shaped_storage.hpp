@@ -0,0 +1,821 @@
+#ifndef ELEMEL_SHAPED_STORAGE_HPP
+#define ELEMEL_SHAPED_STORAGE_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/hash_map.hpp>
+#include <elemel/is_concurrently_readable.hpp>
+#include <elemel/ref_count.hpp>
+#include <elemel/detail/mutex.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <tr1/functional>
+
+namespace elemel {
+    namespace detail {
+        // The keys of a chain of shapes, in slot order. A shape with n keys
+        // uses the first n. A child shares the list of its parent when the
+        // parent uses all of it, so a chain of transitions stores each key
+        // once.
+        //
+        // Keys are added and removed with the shape tree locked, while other
+        // threads look up the keys of their own shapes without locking. The
+        // keys are stored in chunks that never move. A slot is written before
+        // the shapes that use it are created, and is only removed when no
+        // shape uses it. The index from keys to slots is an open addressing
+        // table that is only appended to, and keeps the entries of removed
+        // keys, which lookups skip since the slot holds another key. When
+        // the table grows, the old one is kept for the shapes that were
+        // created with it, until the list is destroyed.
+        template <class Key, class Hash, class Pred, class Allocator>
+        class shape_keys {
+        public:
+            typedef Key key_type;
+            typedef std::size_t size_type;
+
+            // The entries are slots plus one, or zero if they are free.
+            struct index {
+                index *previous;
+                atomic_long *entries;
+                size_type capacity;
+                size_type used;
+            };
+
+            // Only used with the shape tree locked.
+            size_type references;
+
+            shape_keys() :
+                references(0),
+                size_(0),
+                index_(0)
+            {
+                std::fill(chunks_, chunks_ + chunk_count,
+                          static_cast<key_type *>(0));
+            }
+
+            ~shape_keys()
+            {
+                while (size_) {
+                    pop_back();
+                }
+                for (size_type c = 0; c != chunk_count && chunks_[c]; ++c) {
+                    key_allocator_type().deallocate(chunks_[c],
+                                                    chunk_size(c));
+                }
+                while (index_) {
+                    index *previous = index_->previous;
+                    destroy_index(index_, index_->capacity);
+                    index_ = previous;
+                }
+            }
+
+            size_type size() const
+            {
+                return size_;
+            }
+
+            key_type const &operator[](size_type slot) const
+            {
+                size_type c = chunk_of(slot);
+                return chunks_[c][slot - chunk_begin(c)];
+            }
+
+            // The index that shapes created now use.
+            index const *current_index() const
+            {
+                return index_;
+            }
+
+            // Returns the slot of the key among the first n, or n if it is
+            // not there. The index must have been current when the list had
+            // n keys or more.
+            size_type find(index const *ix, key_type const &key,
+                           size_type n) const
+            {
+                if (n == 0) {
+                    return n;
+                }
+                size_type mask = ix->capacity - 1;
+                for (size_type i = Hash()(key) & mask; ; i = (i + 1) & mask) {
+                    long entry = ix->entries[i].load_relaxed();
+                    if (entry == 0) {
+                        return n;
+                    }
+                    size_type slot = size_type(entry - 1);
+                    if (slot < n && Pred()((*this)[slot], key)) {
+                        return slot;
+                    }
+                }
+            }
+
+            // Exception safety: Strong guarantee.
+            void push_back(key_type const &key)
+            {
+                size_type c = chunk_of(size_);
+                if (!chunks_[c]) {
+                    chunks_[c] = key_allocator_type().allocate(chunk_size(c));
+                }
+                std::size_t hash = Hash()(key);
+                if (!index_ || 2 * (index_->used + 1) > index_->capacity) {
+                    grow();
+                }
+                key_allocator_type().construct(
+                    &chunks_[c][size_ - chunk_begin(c)], key);
+                insert(index_, hash, size_);
+                ++size_;
+            }
+
+            // Exception safety: No-throw guarantee.
+            void pop_back()
+            {
+                --size_;
+                size_type c = chunk_of(size_);
+                key_allocator_type().destroy(
+                    &chunks_[c][size_ - chunk_begin(c)]);
+            }
+
+        private:
+            typedef typename Allocator::template rebind<Key>::other
+                key_allocator_type;
+            typedef typename Allocator::template rebind<index>::other
+                index_allocator_type;
+            typedef typename Allocator::template rebind<atomic_long>::other
+                entry_allocator_type;
+
+            // Chunk 0 has slots 0 to 7, and chunk c > 0 has slots
+            // 8 << (c - 1) up to 8 << c.
+            enum { chunk_count = sizeof(size_type) * CHAR_BIT - 2 };
+
+            key_type *chunks_[chunk_count];
+            size_type size_;
+            index *index_;
+
+            shape_keys(shape_keys const &other);
+            shape_keys &operator=(shape_keys const &other);
+
+            static size_type chunk_of(size_type slot)
+            {
+                size_type c = 0;
+                for (size_type q = slot >> 3; q; q >>= 1) {
+                    ++c;
+                }
+                return c;
+            }
+
+            static size_type chunk_begin(size_type c)
+            {
+                return c ? size_type(8) << (c - 1) : 0;
+            }
+
+            static size_type chunk_size(size_type c)
+            {
+                return c ? size_type(8) << (c - 1) : 8;
+            }
+
+            // Replaces the index with a larger one, and keeps the old one
+            // for the shapes that use it.
+            void grow()
+            {
+                size_type capacity = 16;
+                while (capacity < 4 * (size_ + 1)) {
+                    capacity *= 2;
+                }
+                index *ix = index_allocator_type().allocate(1);
+                try {
+                    ix->entries = entry_allocator_type().allocate(capacity);
+                } catch (...) {
+                    index_allocator_type().deallocate(ix, 1);
+                    throw;
+                }
+                for (size_type i = 0; i != capacity; ++i) {
+                    new (&ix->entries[i]) atomic_long(0);
+                }
+                ix->capacity = capacity;
+                ix->used = 0;
+                try {
+                    for (size_type slot = 0; slot != size_; ++slot) {
+                        insert(ix, Hash()((*this)[slot]), slot);
+                    }
+                } catch (...) {
+                    destroy_index(ix, capacity);
+                    throw;
+                }
+                ix->previous = index_;
+                index_ = ix;
+            }
+
+            static void insert(index *ix, std::size_t hash, size_type slot)
+            {
+                size_type mask = ix->capacity - 1;
+                size_type i = hash & mask;
+                while (ix->entries[i].load_relaxed()) {
+                    i = (i + 1) & mask;
+                }
+                ix->entries[i].store_relaxed(long(slot + 1));
+                ++ix->used;
+            }
+
+            static void destroy_index(index *ix, size_type capacity)
+            {
+                entry_allocator_type().deallocate(ix->entries, capacity);
+                index_allocator_type().deallocate(ix, 1);
+            }
+        };
+
+        // An immutable layout of keys to slots, shared by all storages with
+        // the same keys added in the same order. Each shape caches its
+        // transitions to the shapes with one more key. Shapes are reference
+        // counted. A shape holds a reference to its parent, but not to its
+        // children, which remove their transitions when they are destroyed.
+        //
+        // All shapes of one type form a tree, which is locked while shapes
+        // are added and released. Lookups and new references to a shape
+        // that is already held need no lock.
+        template <class Key, class Hash, class Pred, class Allocator>
+        class shape {
+        public:
+            typedef Key key_type;
+            typedef std::size_t size_type;
+
+            // The shape without keys. It is never destroyed.
+            static shape *root()
+            {
+                static shape *root = create_root();
+                return root;
+            }
+
+            shape *parent() const
+            {
+                return parent_;
+            }
+
+            size_type size() const
+            {
+                return size_;
+            }
+
+            // Unique, so that a shape created at the address of a destroyed
+            // one is told apart from it.
+            long id() const
+            {
+                return id_;
+            }
+
+            key_type const &key(size_type slot) const
+            {
+                return (*keys_)[slot];
+            }
+
+            // Returns the slot of the key, or size() if there is none.
+            size_type find(key_type const &key) const
+            {
+                return keys_->find(index_, key, size_);
+            }
+
+            // Returns a reference to the shape with the key appended. The
+            // key must not be in this shape.
+            //
+            // Exception safety: Strong guarantee.
+            shape *add(key_type const &key)
+            {
+                lock_guard<mutex> lock(tree_mutex());
+                typename transition_map::iterator i = transitions_.find(key);
+                if (i != transitions_.end()) {
+                    i->second->references_.add_relaxed(1);
+                    return i->second;
+                }
+
+                keys_type *keys = (keys_->size() == size_) ? keys_ :
+                    copy_keys();
+                shape *child = 0;
+                try {
+                    keys->push_back(key);
+                    try {
+                        child = new (shape_allocator().allocate(1))
+                            shape(this, keys, size_ + 1);
+                        transitions_.insert(std::make_pair(key, child));
+                    } catch (...) {
+                        if (child) {
+                            child->~shape();
+                            shape_allocator().deallocate(child, 1);
+                        }
+                        keys->pop_back();
+                        throw;
+                    }
+                } catch (...) {
+                    if (keys->references == 0) {
+                        destroy_keys(keys);
+                    }
+                    throw;
+                }
+                ++keys->references;
+                references_.add_relaxed(1);
+                return child;
+            }
+
+            // The caller must already hold a reference.
+            void acquire()
+            {
+                references_.add_relaxed(1);
+            }
+
+            // Releases a reference, and destroys the shapes that are no
+            // longer used.
+            //
+            // Exception safety: No-throw guarantee.
+            static void release(shape *s)
+            {
+                lock_guard<mutex> lock(tree_mutex());
+                while (s->references_.add_acq_rel(-1) == 0) {
+                    shape *parent = s->parent_;
+                    keys_type *keys = s->keys_;
+                    parent->transitions_.erase((*keys)[s->size_ - 1]);
+                    if (--keys->references == 0) {
+                        destroy_keys(keys);
+                    } else if (keys->size() == s->size_) {
+                        keys->pop_back();
+                    }
+                    s->~shape();
+                    shape_allocator().deallocate(s, 1);
+                    s = parent;
+                }
+            }
+
+        private:
+            typedef shape_keys<Key, Hash, Pred, Allocator> keys_type;
+            typedef typename keys_type::index index_type;
+            typedef typename Allocator::template rebind<shape>::other
+                shape_allocator_type;
+            typedef typename Allocator::template rebind<keys_type>::other
+                keys_allocator_type;
+            typedef typename Allocator::template rebind<
+                std::pair<Key, shape *> >::other transition_allocator_type;
+            typedef hash_map<Key, shape *, Hash, Pred,
+                             transition_allocator_type> transition_map;
+
+            shape *parent_;
+            keys_type *keys_;
+            index_type const *index_;
+            size_type size_;
+            long id_;
+            atomic_long references_;
+
+            // Only used with the tree locked.
+            transition_map transitions_;
+
+            shape(shape *parent, keys_type *keys, size_type size) :
+                parent_(parent),
+                keys_(keys),
+                index_(keys->current_index()),
+                size_(size),
+                id_(next_id()),
+                references_(1)
+            { }
+
+            static mutex &tree_mutex()
+            {
+                static mutex *tree_mutex = new mutex;
+                return *tree_mutex;
+            }
+
+            static long next_id()
+            {
+                static atomic_long ids;
+                return ids.add_relaxed(1);
+            }
+
+            static shape *create_root()
+            {
+                keys_type *keys = new (keys_allocator_type().allocate(1))
+                    keys_type();
+                keys->references = 1;
+                return new (shape_allocator().allocate(1))
+                    shape(0, keys, 0);
+            }
+
+            static shape_allocator_type shape_allocator()
+            {
+                return shape_allocator_type();
+            }
+
+            // Copies the keys of this shape into a new list.
+            keys_type *copy_keys() const
+            {
+                keys_type *keys = new (keys_allocator_type().allocate(1))
+                    keys_type();
+                try {
+                    for (size_type i = 0; i != size_; ++i) {
+                        keys->push_back((*keys_)[i]);
+                    }
+                } catch (...) {
+                    destroy_keys(keys);
+                    throw;
+                }
+                return keys;
+            }
+
+            static void destroy_keys(keys_type *keys)
+            {
+                keys->~keys_type();
+                keys_allocator_type().deallocate(keys, 1);
+            }
+        };
+
+        // A key and value of a shaped storage. Its arrow operator lets
+        // iterators return it from their own arrow operator.
+        template <class Key, class Data>
+        struct shaped_reference {
+            Key const &first;
+            Data &second;
+
+            shaped_reference(Key const &key, Data &data) :
+                first(key),
+                second(data)
+            { }
+
+            shaped_reference const *operator->() const
+            {
+                return this;
+            }
+        };
+
+        template <class Shape, class Data>
+        class shaped_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef shaped_reference<typename Shape::key_type, Data>
+                value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef value_type pointer;
+            typedef value_type reference;
+
+            shaped_iterator() :
+                shape_(0),
+                values_(0),
+                slot_(0)
+            { }
+
+            shaped_iterator(Shape const *shape, Data *values, std::size_t slot) :
+                shape_(shape),
+                values_(values),
+                slot_(slot)
+            { }
+
+            template <class Other>
+            shaped_iterator(shaped_iterator<Shape, Other> const &other) :
+                shape_(other.shape()),
+                values_(other.values()),
+                slot_(other.slot())
+            { }
+
+            reference operator*() const
+            {
+                return reference(shape_->key(slot_), values_[slot_]);
+            }
+
+            pointer operator->() const
+            {
+                return **this;
+            }
+
+            shaped_iterator &operator++()
+            {
+                ++slot_;
+                return *this;
+            }
+
+            shaped_iterator operator++(int)
+            {
+                shaped_iterator result(*this);
+                ++slot_;
+                return result;
+            }
+
+            Shape const *shape() const
+            {
+                return shape_;
+            }
+
+            Data *values() const
+            {
+                return values_;
+            }
+
+            std::size_t slot() const
+            {
+                return slot_;
+            }
+
+        private:
+            Shape const *shape_;
+            Data *values_;
+            std::size_t slot_;
+        };
+
+        template <class Shape, class Left, class Right>
+        bool operator==(shaped_iterator<Shape, Left> const &left,
+                        shaped_iterator<Shape, Right> const &right)
+        {
+            return left.slot() == right.slot();
+        }
+
+        template <class Shape, class Left, class Right>
+        bool operator!=(shaped_iterator<Shape, Left> const &left,
+                        shaped_iterator<Shape, Right> const &right)
+        {
+            return left.slot() != right.slot();
+        }
+    }
+
+    // A map that stores its values in a dense array, and shares the mapping
+    // from keys to slots with all other maps that have the same keys, added
+    // in the same order. The mappings, or shapes, form a tree of
+    // transitions, where adding a key to a map moves it to a child shape.
+    // Maps with the same set of keys thus cost little more than their
+    // values, and a lookup is a hash lookup in the shape and a load from
+    // the array. It is meant as the Storage of property_map, when many
+    // instances have the same properties.
+    //
+    // Erasing a key rebuilds the shape from the first slot after the key,
+    // and moves the values after it. Iteration is in the order that the
+    // keys were added.
+    //
+    // All maps of one type share the shape tree. It is locked when a map
+    // moves to another shape, so that maps can be used from several
+    // threads, but each map only from one thread at a time. Hash, Pred and
+    // Allocator are default constructed for the shapes.
+    //
+    // Inserting may move all values, and invalidates pointers and
+    // references. Erasing invalidates those to the erased value and after.
+    template <
+        class Key,
+        class Data,
+        class Hash = std::tr1::hash<Key>,
+        class Pred = std::equal_to<Key>,
+        class Allocator = std::allocator<std::pair<Key, Data> >
+    >
+    class shaped_storage {
+    public:
+        typedef Key key_type;
+        typedef Data data_type;
+        typedef std::pair<key_type, data_type> value_type;
+        typedef detail::shape<Key, Hash, Pred, Allocator> shape_type;
+        typedef typename Allocator::template rebind<data_type>::other
+            allocator_type;
+        typedef std::size_t size_type;
+        typedef detail::shaped_iterator<shape_type, data_type> iterator;
+        typedef detail::shaped_iterator<shape_type, data_type const>
+            const_iterator;
+
+        // Remembers the slot of a key in the shape of the map that it was
+        // last used with. Finding the key with the handle in a map of the
+        // same shape is then a compare and a load, without hashing the key.
+        class lookup_handle {
+        public:
+            explicit lookup_handle(key_type const &key) :
+                key_(key),
+                shape_(0),
+                slot_(0)
+            { }
+
+            key_type const &key() const
+            {
+                return key_;
+            }
+
+        private:
+            friend class shaped_storage;
+
+            key_type key_;
+            long shape_;
+            size_type slot_;
+        };
+
+        shaped_storage() :
+            shape_(shape_type::root())
+        {
+            shape_->acquire();
+        }
+
+        shaped_storage(shaped_storage const &other) :
+            values_(other.values_),
+            shape_(other.shape_)
+        {
+            shape_->acquire();
+        }
+
+        ~shaped_storage()
+        {
+            shape_type::release(shape_);
+        }
+
+        shaped_storage &operator=(shaped_storage const &other)
+        {
+            shaped_storage temp(other);
+            swap(temp);
+            return *this;
+        }
+
+        // The shape is the same for all maps with the same keys, added in
+        // the same order.
+        shape_type const *shape() const
+        {
+            return shape_;
+        }
+
+        iterator begin()
+        {
+            return iterator(shape_, values(), 0);
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(shape_, values(), 0);
+        }
+
+        iterator end()
+        {
+            return iterator(shape_, values(), size());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(shape_, values(), size());
+        }
+
+        bool empty() const
+        {
+            return values_.empty();
+        }
+
+        size_type size() const
+        {
+            return values_.size();
+        }
+
+        data_type &operator[](key_type const &key)
+        {
+            return insert(value_type(key, data_type())).first->second;
+        }
+
+        // Exception safety: Strong guarantee.
+        std::pair<iterator, bool> insert(value_type const &value)
+        {
+            size_type slot = shape_->find(value.first);
+            if (slot != size()) {
+                return std::make_pair(iterator(shape_, values(), slot),
+                                      false);
+            }
+            shape_type *next = shape_->add(value.first);
+            try {
+                values_.push_back(value.second);
+            } catch (...) {
+                shape_type::release(next);
+                throw;
+            }
+            shape_type::release(shape_);
+            shape_ = next;
+            return std::make_pair(iterator(shape_, values(), slot), true);
+        }
+
+        // Exception safety: Basic guarantee.
+        void erase(const_iterator position)
+        {
+            size_type slot = position.slot();
+            shape_type *next = shape_;
+            for (size_type i = size(); i != slot; --i) {
+                next = next->parent();
+            }
+            next->acquire();
+            try {
+                for (size_type i = slot + 1; i != size(); ++i) {
+                    shape_type *child = next->add(shape_->key(i));
+                    shape_type::release(next);
+                    next = child;
+                }
+                values_.erase(values_.begin() + slot);
+            } catch (...) {
+                shape_type::release(next);
+                throw;
+            }
+            shape_type::release(shape_);
+            shape_ = next;
+        }
+
+        size_type erase(key_type const &key)
+        {
+            size_type slot = shape_->find(key);
+            if (slot == size()) {
+                return 0;
+            }
+            erase(const_iterator(shape_, values(), slot));
+            return 1;
+        }
+
+        // Exception safety: No-throw guarantee.
+        void swap(shaped_storage &other)
+        {
+            values_.swap(other.values_);
+            std::swap(shape_, other.shape_);
+        }
+
+        // Exception safety: No-throw guarantee.
+        void clear()
+        {
+            values_.clear();
+            shape_type *root = shape_type::root();
+            root->acquire();
+            shape_type::release(shape_);
+            shape_ = root;
+        }
+
+        iterator find(key_type const &key)
+        {
+            return iterator(shape_, values(), shape_->find(key));
+        }
+
+        const_iterator find(key_type const &key) const
+        {
+            return const_iterator(shape_, values(), shape_->find(key));
+        }
+
+        iterator find(lookup_handle &handle)
+        {
+            return iterator(shape_, values(), find_slot(handle));
+        }
+
+        const_iterator find(lookup_handle &handle) const
+        {
+            return const_iterator(shape_, values(), find_slot(handle));
+        }
+
+        size_type count(key_type const &key) const
+        {
+            return shape_->find(key) != size();
+        }
+
+    private:
+        std::vector<data_type, allocator_type> values_;
+        shape_type *shape_;
+
+        data_type *values()
+        {
+            return values_.empty() ? 0 : &values_[0];
+        }
+
+        data_type const *values() const
+        {
+            return values_.empty() ? 0 : &values_[0];
+        }
+
+        size_type find_slot(lookup_handle &handle) const
+        {
+            if (handle.shape_ != shape_->id()) {
+                handle.slot_ = shape_->find(handle.key_);
+                handle.shape_ = shape_->id();
+            }
+            return handle.slot_;
+        }
+    };
+
+    template <class K, class D, class H, class P, class A>
+    void swap(shaped_storage<K, D, H, P, A> &left,
+              shaped_storage<K, D, H, P, A> &right)
+    {
+        left.swap(right);
+    }
+
+    // Copies add references to the shared shape.
+    template <class K, class D, class H, class P, class A>
+    struct is_concurrently_readable<shaped_storage<K, D, H, P, A> > :
+        detail::false_type
+    { };
+}
+
+#endif // ELEMEL_SHAPED_STORAGE_HPP
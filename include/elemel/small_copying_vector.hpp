@@ -0,0 +1,96 @@
+#ifndef ELEMEL_SMALL_COPYING_VECTOR_HPP
+#define ELEMEL_SMALL_COPYING_VECTOR_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/copying_vector.hpp>
+
+namespace elemel {
+    // A copying vector that stores up to N values inline. Small vectors never
+    // touch the allocator.
+    template <class T, std::size_t N, class Allocator = std::allocator<T> >
+    class small_copying_vector : public copying_vector<T, Allocator, N> {
+    public:
+        typedef copying_vector<T, Allocator, N> base_type;
+        typedef typename base_type::value_type value_type;
+        typedef typename base_type::allocator_type allocator_type;
+        typedef typename base_type::size_type size_type;
+
+        explicit small_copying_vector(allocator_type const &allocator = allocator_type()) :
+            base_type(allocator)
+        { }
+
+        explicit small_copying_vector(size_type n,
+                                      value_type const &value = value_type(),
+                                      allocator_type const &allocator = allocator_type()) :
+            base_type(n, value, allocator)
+        { }
+
+        small_copying_vector(small_copying_vector const &other) :
+            base_type(other)
+        { }
+
+#if !defined(ELEMEL_NO_CXX11)
+        // Exception safety: No-throw guarantee if the values are in
+        // allocated storage, or if they can be moved without throwing.
+        small_copying_vector(small_copying_vector &&other)
+            noexcept(N == 0 || std::is_nothrow_move_constructible<T>::value) :
+            base_type(std::move(other))
+        { }
+#endif
+
+        // Exception safety: Basic guarantee.
+        small_copying_vector &operator=(small_copying_vector const &other)
+        {
+            base_type::operator=(other);
+            return *this;
+        }
+
+#if !defined(ELEMEL_NO_CXX11)
+        // Exception safety: No-throw guarantee if the values are in
+        // allocated storage, or if they can be moved without throwing.
+        small_copying_vector &operator=(small_copying_vector &&other)
+            noexcept(N == 0 || std::is_nothrow_move_constructible<T>::value)
+        {
+            base_type::operator=(std::move(other));
+            return *this;
+        }
+#endif
+
+        // Exception safety: No-throw guarantee if the values of both vectors
+        // are in allocated storage. Basic guarantee otherwise.
+        void swap(small_copying_vector &other)
+        {
+            base_type::swap(other);
+        }
+    };
+}
+
+namespace std {
+    template <class T, std::size_t N, class Allocator>
+    void swap(elemel::small_copying_vector<T, N, Allocator> &first,
+              elemel::small_copying_vector<T, N, Allocator> &second)
+    {
+        first.swap(second);
+    }
+}
+
+#endif // ELEMEL_SMALL_COPYING_VECTOR_HPP
@@ -0,0 +1,74 @@
+#ifndef ELEMEL_SORTED_LAYOUT_HPP
+#define ELEMEL_SORTED_LAYOUT_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/binary_find.hpp>
+
+namespace elemel {
+    // Searches the sorted values of a flat map directly. This is the default
+    // layout, and it needs no index.
+    struct sorted_layout {
+        template <class Key, class Compare, class Allocator>
+        class index {
+        public:
+            typedef Key key_type;
+            typedef Compare compare;
+            typedef Allocator allocator_type;
+
+            explicit index(allocator_type const &allocator = allocator_type())
+            { }
+
+            // Exception safety: No-throw guarantee.
+            template <class RandomAccessIterator>
+            void rebuild(RandomAccessIterator first, RandomAccessIterator last)
+            { }
+
+            template <class RandomAccessIterator>
+            RandomAccessIterator find(RandomAccessIterator first,
+                                      RandomAccessIterator last,
+                                      key_type const &key,
+                                      compare const &comp) const
+            {
+                return binary_find(first, last, key, comp);
+            }
+
+            template <class RandomAccessIterator, class ForwardIterator,
+                      class OutputIterator>
+            OutputIterator find_many(RandomAccessIterator first,
+                                     RandomAccessIterator last,
+                                     ForwardIterator keys_first,
+                                     ForwardIterator keys_last,
+                                     OutputIterator out,
+                                     compare const &comp) const
+            {
+                return binary_find_many(first, last, keys_first, keys_last,
+                                        out, comp);
+            }
+
+            // Exception safety: No-throw guarantee.
+            void swap(index &other)
+            { }
+        };
+    };
+}
+
+#endif // ELEMEL_SORTED_LAYOUT_HPP
@@ -0,0 +1,699 @@
+#ifndef ELEMEL_SPLIT_FLAT_MAP_HPP
+#define ELEMEL_SPLIT_FLAT_MAP_HPP
+
+// Copyright (C) 2011 by Mikael Lind
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <elemel/binary_find.hpp>
+#include <elemel/copying_vector.hpp>
+#include <elemel/flat_map.hpp>
+#include <elemel/map_pair_compare.hpp>
+#include <elemel/sorted_layout.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace elemel {
+    namespace detail {
+        // What a split map iterator refers to: a key and its data, which are
+        // stored apart. Reads like a pair.
+        template <class Value, class Data>
+        struct split_reference {
+            typedef typename Value::first_type key_type;
+
+            key_type const &first;
+            Data &second;
+
+            split_reference(key_type const &key, Data &data) :
+                first(key),
+                second(data)
+            { }
+
+            operator Value() const
+            {
+                return Value(first, second);
+            }
+        };
+
+        // Gives operator->() of a proxy iterator something to point to.
+        template <class Reference>
+        class arrow_proxy {
+        public:
+            explicit arrow_proxy(Reference const &reference) :
+                reference_(reference)
+            { }
+
+            Reference const *operator->() const
+            {
+                return &reference_;
+            }
+
+        private:
+            Reference reference_;
+        };
+
+        // Walks the parallel key and data vectors of a split map in step.
+        template <class Value, class Data>
+        class split_iterator {
+        public:
+            typedef typename Value::first_type key_type;
+
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef split_reference<Value, Data> reference;
+            typedef arrow_proxy<reference> pointer;
+
+            split_iterator() :
+                key_(0),
+                data_(0)
+            { }
+
+            split_iterator(key_type const *key, Data *data) :
+                key_(key),
+                data_(data)
+            { }
+
+            // Converts an iterator to a const iterator.
+            template <class OtherData>
+            split_iterator(split_iterator<Value, OtherData> const &other) :
+                key_(other.key_pointer()),
+                data_(other.data_pointer())
+            { }
+
+            key_type const *key_pointer() const
+            {
+                return key_;
+            }
+
+            Data *data_pointer() const
+            {
+                return data_;
+            }
+
+            reference operator*() const
+            {
+                return reference(*key_, *data_);
+            }
+
+            pointer operator->() const
+            {
+                return pointer(**this);
+            }
+
+            reference operator[](difference_type n) const
+            {
+                return reference(key_[n], data_[n]);
+            }
+
+            split_iterator &operator++()
+            {
+                ++key_;
+                ++data_;
+                return *this;
+            }
+
+            split_iterator operator++(int)
+            {
+                split_iterator result(*this);
+                ++*this;
+                return result;
+            }
+
+            split_iterator &operator--()
+            {
+                --key_;
+                --data_;
+                return *this;
+            }
+
+            split_iterator operator--(int)
+            {
+                split_iterator result(*this);
+                --*this;
+                return result;
+            }
+
+            split_iterator &operator+=(difference_type n)
+            {
+                key_ += n;
+                data_ += n;
+                return *this;
+            }
+
+            split_iterator &operator-=(difference_type n)
+            {
+                key_ -= n;
+                data_ -= n;
+                return *this;
+            }
+
+            split_iterator operator+(difference_type n) const
+            {
+                return split_iterator(key_ + n, data_ + n);
+            }
+
+            split_iterator operator-(difference_type n) const
+            {
+                return split_iterator(key_ - n, data_ - n);
+            }
+
+        private:
+            key_type const *key_;
+            Data *data_;
+        };
+
+        template <class Value, class Data>
+        split_iterator<Value, Data>
+        operator+(std::ptrdiff_t n, split_iterator<Value, Data> const &i)
+        {
+            return i + n;
+        }
+
+        template <class Value, class Left, class Right>
+        std::ptrdiff_t operator-(split_iterator<Value, Left> const &left,
+                                 split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() - right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator==(split_iterator<Value, Left> const &left,
+                        split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() == right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator!=(split_iterator<Value, Left> const &left,
+                        split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() != right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator<(split_iterator<Value, Left> const &left,
+                       split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() < right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator>(split_iterator<Value, Left> const &left,
+                       split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() > right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator<=(split_iterator<Value, Left> const &left,
+                        split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() <= right.key_pointer();
+        }
+
+        template <class Value, class Left, class Right>
+        bool operator>=(split_iterator<Value, Left> const &left,
+                        split_iterator<Value, Right> const &right)
+        {
+            return left.key_pointer() >= right.key_pointer();
+        }
+
+        // Turns the key pointers that an index finds into map iterators.
+        template <class Iterator, class OutputIterator>
+        class split_find_output {
+        public:
+            typedef typename Iterator::key_type key_type;
+
+            typedef std::output_iterator_tag iterator_category;
+            typedef void value_type;
+            typedef void difference_type;
+            typedef void pointer;
+            typedef void reference;
+
+            split_find_output(Iterator first, key_type const *keys,
+                              OutputIterator out) :
+                first_(first),
+                keys_(keys),
+                out_(out)
+            { }
+
+            OutputIterator base() const
+            {
+                return out_;
+            }
+
+            split_find_output &operator*()
+            {
+                return *this;
+            }
+
+            split_find_output &operator=(key_type const *key)
+            {
+                *out_ = first_ + (key - keys_);
+                return *this;
+            }
+
+            split_find_output &operator++()
+            {
+                ++out_;
+                return *this;
+            }
+
+            split_find_output operator++(int)
+            {
+                split_find_output result(*this);
+                ++out_;
+                return result;
+            }
+
+        private:
+            Iterator first_;
+            key_type const *keys_;
+            OutputIterator out_;
+        };
+    }
+
+    // A flat map that keeps the keys and the data in separate vectors, so
+    // that searches only touch the keys. This pays off when the data is
+    // large. The iterators refer to pair-like proxies, with a const
+    // reference to the key as first and a reference to the data as second.
+    template <
+        class Key,
+        class Data,
+        class Compare = std::less<Key>,
+        class Allocator = std::allocator<std::pair<Key, Data> >,
+        class Layout = sorted_layout
+    >
+    class split_flat_map {
+    public:
+        typedef Key key_type;
+        typedef Data data_type;
+        typedef std::pair<key_type, data_type> value_type;
+        typedef Compare key_compare;
+        typedef Allocator allocator_type;
+        typedef Layout layout_type;
+        typedef typename allocator_type::template rebind<key_type>::other
+            key_allocator_type;
+        typedef typename allocator_type::template rebind<data_type>::other
+            data_allocator_type;
+        typedef copying_vector<key_type, key_allocator_type> key_vector_type;
+        typedef copying_vector<data_type, data_allocator_type>
+            data_vector_type;
+        typedef typename layout_type::template index<key_type, key_compare,
+                                                     allocator_type>
+            index_type;
+
+        typedef detail::split_iterator<value_type, data_type> iterator;
+        typedef detail::split_iterator<value_type, data_type const>
+            const_iterator;
+        typedef typename iterator::reference reference;
+        typedef typename const_iterator::reference const_reference;
+        typedef typename iterator::pointer pointer;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        explicit split_flat_map(key_compare const &comp = key_compare(),
+                                allocator_type const &allocator = allocator_type()) :
+            comp_(comp),
+            keys_(key_allocator_type(allocator)),
+            data_(data_allocator_type(allocator)),
+            index_(allocator)
+        { }
+
+        template <class InputIterator>
+        split_flat_map(InputIterator first, InputIterator last,
+                       key_compare const &comp = key_compare(),
+                       allocator_type const &allocator = allocator_type()) :
+            comp_(comp),
+            keys_(key_allocator_type(allocator)),
+            data_(data_allocator_type(allocator)),
+            index_(allocator)
+        {
+            insert(first, last);
+        }
+
+        template <class InputIterator>
+        split_flat_map(sorted_unique_tag, InputIterator first,
+                       InputIterator last,
+                       key_compare const &comp = key_compare(),
+                       allocator_type const &allocator = allocator_type()) :
+            comp_(comp),
+            keys_(key_allocator_type(allocator)),
+            data_(data_allocator_type(allocator)),
+            index_(allocator)
+        {
+            insert(sorted_unique, first, last);
+        }
+
+        // Exception safety: Strong guarantee.
+        split_flat_map &operator=(split_flat_map const &other)
+        {
+            split_flat_map temp(other);
+            swap(temp);
+            return *this;
+        }
+
+        iterator begin()
+        {
+            return iterator(keys_.begin(), data_.begin());
+        }
+
+        iterator end()
+        {
+            return iterator(keys_.end(), data_.end());
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(keys_.begin(), data_.begin());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(keys_.end(), data_.end());
+        }
+
+        reverse_iterator rbegin()
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend()
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rbegin() const
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        bool empty() const
+        {
+            return keys_.empty();
+        }
+
+        size_type size() const
+        {
+            return keys_.size();
+        }
+
+        size_type max_size() const
+        {
+            return std::min(keys_.max_size(), data_.max_size());
+        }
+
+        // Only default-constructs the data if the key is missing.
+        data_type &operator[](key_type const &key)
+        {
+            key_type const *i = elemel::lower_bound(keys_.begin(),
+                                                    keys_.end(), key, comp_);
+            size_type index = i - keys_.begin();
+            if (i == keys_.end() || comp_(key, *i)) {
+                insert_at(index, key, data_type());
+            }
+            return data_[index];
+        }
+
+        std::pair<iterator, bool> insert(value_type const &value)
+        {
+            key_type const *i = elemel::lower_bound(keys_.begin(),
+                                                    keys_.end(),
+                                                    value.first, comp_);
+            size_type index = i - keys_.begin();
+            if (i != keys_.end() && !comp_(value.first, *i)) {
+                return std::make_pair(begin() + index, false);
+            }
+            insert_at(index, value.first, value.second);
+            return std::make_pair(begin() + index, true);
+        }
+
+        // Sorts the values and merges them with the values already in the
+        // map. As for single values, a value is not inserted if its key is
+        // already present.
+        //
+        // Exception safety: Strong guarantee.
+        template <class InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            value_vector_type values(get_allocator());
+            values.insert(values.end(), first, last);
+            std::stable_sort(values.begin(), values.end(),
+                             value_compare(comp_));
+            erase_duplicates(values);
+            merge(values.begin(), values.end());
+        }
+
+        // Like insert(first, last), but skips the sorting.
+        //
+        // Exception safety: Strong guarantee.
+        template <class InputIterator>
+        void insert(sorted_unique_tag, InputIterator first,
+                    InputIterator last)
+        {
+            value_vector_type values(get_allocator());
+            values.insert(values.end(), first, last);
+            merge(values.begin(), values.end());
+        }
+
+        void erase(iterator position)
+        {
+            erase(position, position + 1);
+        }
+
+        size_type erase(key_type const &key)
+        {
+            iterator i = find(key);
+            if (i != end()) {
+                erase(i);
+                return 1;
+            } else {
+                return 0;
+            }
+        }
+
+        void erase(iterator first, iterator last)
+        {
+            size_type first_index = first - begin();
+            size_type last_index = last - begin();
+            keys_.erase(keys_.begin() + first_index,
+                        keys_.begin() + last_index);
+            data_.erase(data_.begin() + first_index,
+                        data_.begin() + last_index);
+            index_.rebuild(keys_.begin(), keys_.end());
+        }
+
+        void swap(split_flat_map &other)
+        {
+            std::swap(comp_, other.comp_);
+            keys_.swap(other.keys_);
+            data_.swap(other.data_);
+            index_.swap(other.index_);
+        }
+
+        void clear()
+        {
+            keys_.clear();
+            data_.clear();
+            index_.rebuild(keys_.begin(), keys_.end());
+        }
+
+        iterator find(key_type const &key)
+        {
+            return begin() + (index_.find(keys_.begin(), keys_.end(), key,
+                                          comp_) - keys_.begin());
+        }
+
+        const_iterator find(key_type const &key) const
+        {
+            return begin() + (index_.find(keys_.begin(), keys_.end(), key,
+                                          comp_) - keys_.begin());
+        }
+
+        // Writes an iterator to the value of each key in the range, or end()
+        // if there is none, to out. This is faster than calling find() for
+        // each key, particularly if the keys are sorted.
+        template <class ForwardIterator, class OutputIterator>
+        OutputIterator find_many(ForwardIterator keys_first,
+                                 ForwardIterator keys_last,
+                                 OutputIterator out)
+        {
+            detail::split_find_output<iterator, OutputIterator>
+                result(begin(), keys_.begin(), out);
+            return index_.find_many(keys_.begin(), keys_.end(), keys_first,
+                                    keys_last, result, comp_).base();
+        }
+
+        template <class ForwardIterator, class OutputIterator>
+        OutputIterator find_many(ForwardIterator keys_first,
+                                 ForwardIterator keys_last,
+                                 OutputIterator out) const
+        {
+            detail::split_find_output<const_iterator, OutputIterator>
+                result(begin(), keys_.begin(), out);
+            return index_.find_many(keys_.begin(), keys_.end(), keys_first,
+                                    keys_last, result, comp_).base();
+        }
+
+        // The sorted keys, which line up with the data.
+        key_vector_type const &keys() const
+        {
+            return keys_;
+        }
+
+        key_compare key_comp() const
+        {
+            return comp_;
+        }
+
+        allocator_type get_allocator() const
+        {
+            return allocator_type(keys_.get_allocator());
+        }
+
+    private:
+        typedef map_pair_compare<key_type, key_compare> value_compare;
+        typedef copying_vector<value_type, allocator_type> value_vector_type;
+
+        key_compare comp_;
+        key_vector_type keys_;
+        data_vector_type data_;
+        index_type index_;
+
+        // Exception safety: Basic guarantee.
+        void insert_at(size_type index, key_type const &key,
+                       data_type const &data)
+        {
+            keys_.insert(keys_.begin() + index, key);
+            try {
+                data_.insert(data_.begin() + index, data);
+            } catch (...) {
+                keys_.erase(keys_.begin() + index);
+                throw;
+            }
+            index_.rebuild(keys_.begin(), keys_.end());
+        }
+
+        // Keeps the first value of each run of equivalent keys.
+        void erase_duplicates(value_vector_type &values) const
+        {
+            if (!values.empty()) {
+                typename value_vector_type::iterator result = values.begin();
+                for (typename value_vector_type::iterator i = result + 1;
+                     i != values.end(); ++i)
+                {
+                    if (comp_(result->first, i->first)) {
+                        ++result;
+                        if (result != i) {
+                            *result = *i;
+                        }
+                    }
+                }
+                values.erase(result + 1, values.end());
+            }
+        }
+
+        // Merges sorted values with unique keys into the map. Values with
+        // keys that are already present are skipped. Values past the last
+        // key are appended in place.
+        //
+        // Exception safety: Strong guarantee.
+        template <class RandomAccessIterator>
+        void merge(RandomAccessIterator first, RandomAccessIterator last)
+        {
+            if (first == last) {
+                return;
+            }
+            size_type n = size() + (last - first);
+            if (empty() || comp_(keys_.back(), first->first)) {
+                size_type old_size = size();
+                keys_.reserve(n);
+                data_.reserve(n);
+                try {
+                    for (; first != last; ++first) {
+                        keys_.push_back(first->first);
+                        data_.push_back(first->second);
+                    }
+                    index_.rebuild(keys_.begin(), keys_.end());
+                } catch (...) {
+                    keys_.erase(keys_.begin() + old_size, keys_.end());
+                    data_.erase(data_.begin() + old_size, data_.end());
+                    throw;
+                }
+                return;
+            }
+
+            key_vector_type keys(keys_.get_allocator());
+            data_vector_type data(data_.get_allocator());
+            keys.reserve(n);
+            data.reserve(n);
+            size_type i = 0;
+            while (i != size() || first != last) {
+                if (first == last ||
+                    (i != size() && !comp_(first->first, keys_[i])))
+                {
+                    if (first != last && !comp_(keys_[i], first->first)) {
+                        // The key is already present.
+                        ++first;
+                    }
+                    keys.push_back(keys_[i]);
+                    data.push_back(data_[i]);
+                    ++i;
+                } else {
+                    keys.push_back(first->first);
+                    data.push_back(first->second);
+                    ++first;
+                }
+            }
+            index_type index(get_allocator());
+            index.rebuild(keys.begin(), keys.end());
+            keys_.swap(keys);
+            data_.swap(data);
+            index_.swap(index);
+        }
+    };
+}
+
+namespace std {
+    template <class Key, class Data, class Compare, class Allocator,
+              class Layout>
+    void swap(elemel::split_flat_map<Key, Data, Compare, Allocator,
+                                     Layout> &first,
+              elemel::split_flat_map<Key, Data, Compare, Allocator,
+                                     Layout> &second)
+    {
+        first.swap(second);
+    }
+}
+
+#endif // ELEMEL_SPLIT_FLAT_MAP_HPP
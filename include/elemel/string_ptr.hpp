@@ -1,13 +1,19 @@
 #ifndef ELEMEL_STRING_PTR_HPP
 #define ELEMEL_STRING_PTR_HPP
 
+#include <elemel/hash_string.hpp>
+#include <elemel/is_trivially_relocatable.hpp>
 #include <elemel/raw_allocator.hpp>
-#include <elemel/ref_ptr.hpp>
+#include <elemel/detail/string_compare.hpp>
 #include <elemel/detail/string_impl.hpp>
+#include <elemel/detail/type_traits.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <tr1/functional>
 
 namespace elemel {
     template <
@@ -28,64 +34,206 @@ namespace elemel {
         typedef value_type const *const_pointer;
         typedef value_type const *const_iterator;
 
+        // Does not allocate.
         explicit basic_string_ptr(raw_allocator_type const &alloc =
-                                  raw_allocator_type()) :
-            impl_(impl_type::create(0, 0, alloc))
-        { }
+                                  raw_allocator_type())
+        {
+            init(0, 0, alloc);
+        }
 
         explicit basic_string_ptr(const_pointer str,
                                   raw_allocator_type const &alloc =
-                                  raw_allocator_type()) :
-            impl_(impl_type::create(str, Traits::length(str), alloc))
-        { }
+                                  raw_allocator_type())
+        {
+            init(str, Traits::length(str), alloc);
+        }
 
         basic_string_ptr(const_pointer str, size_type n,
                          raw_allocator_type const &alloc =
-                         raw_allocator_type()) :
-            impl_(impl_type::create(str, n, alloc))
-        { }
+                         raw_allocator_type())
+        {
+            init(str, n, alloc);
+        }
 
         basic_string_ptr(const_pointer first, const_pointer last,
                          raw_allocator_type const &alloc =
-                         raw_allocator_type()) :
-            impl_(impl_type::create(first, last - first, alloc))
-        { }
+                         raw_allocator_type())
+        {
+            init(first, last - first, alloc);
+        }
+
+        basic_string_ptr(basic_string_ptr const &other) :
+            storage_(other.storage_)
+        {
+            if (!is_inline()) {
+                impl()->add_ref();
+            }
+        }
+
+        ~basic_string_ptr()
+        {
+            if (!is_inline()) {
+                impl()->release();
+            }
+        }
+
+        basic_string_ptr &operator=(basic_string_ptr const &other)
+        {
+            basic_string_ptr(other).swap(*this);
+            return *this;
+        }
 
         const_pointer data() const
         {
-            return impl_->data();
+            return is_inline() ? storage_.chars : impl()->data();
         }
 
         size_type size() const
         {
-            return impl_->size();
+            if (is_inline()) {
+                return inline_capacity - storage_.chars[inline_capacity];
+            } else {
+                return impl()->size();
+            }
         }
 
         const_pointer c_str() const
         {
-            return impl_->data();
+            return data();
         }
 
         const_iterator begin() const
         {
-            return impl_->data();
+            return data();
         }
 
         const_iterator end() const
         {
-            return impl_->data() + impl_->size();
+            return data() + size();
+        }
+
+        // Returns a negative number, zero or a positive number if this
+        // string is ordered before, with or after the other string.
+        int compare(basic_string_ptr const &other) const
+        {
+            return detail::string_compare<traits_type>::compare(
+                begin(), end(), other.begin(), other.end());
+        }
+
+        int compare(const_pointer str) const
+        {
+            assert(str);
+            return detail::string_compare<traits_type>::compare_terminated(
+                begin(), end(), str);
         }
 
+        // The hash of the characters, as computed by hash_string(). Long
+        // strings compute it once, when they are created.
+        std::size_t hash() const
+        {
+            if (is_inline()) {
+                return hash_string(begin(), end());
+            } else {
+                return impl()->hash();
+            }
+        }
+
+        // Must be called before the string is handed to another thread, if
+        // the reference count is a deferred_ref_count.
+        void share() const
+        {
+            if (!is_inline()) {
+                impl()->share();
+            }
+        }
+
+        // Tells if the characters are stored in the object itself. Strings
+        // of up to inline_capacity characters are.
+        bool is_inline() const
+        {
+            return storage_.chars[inline_capacity] != heap_marker;
+        }
+
+        void swap(basic_string_ptr &other)
+        {
+            std::swap(storage_, other.storage_);
+        }
+
+        // The longest string that is stored inline. The object is as large
+        // as three pointers, with room for the unused count.
+        static size_type const inline_capacity =
+            3 * sizeof(void *) / sizeof(value_type) - 1;
+
     private:
-        ref_ptr<impl_type> impl_;
+        // The last inline character holds the unused inline capacity, so
+        // that it doubles as the terminator when the inline storage is
+        // full. It holds a value past the capacity when the characters are
+        // in a shared impl instead.
+        static value_type const heap_marker = value_type(inline_capacity + 1);
+
+        // The impl pointer is copied in and out of the characters, and
+        // only shares the alignment.
+        union storage {
+            impl_type *align;
+            value_type chars[inline_capacity + 1];
+        };
+
+        storage storage_;
+
+        impl_type *impl() const
+        {
+            impl_type *result;
+            std::memcpy(&result, storage_.chars, sizeof(result));
+            return result;
+        }
+
+        void init(const_pointer str, size_type n,
+                  raw_allocator_type const &alloc)
+        {
+            if (n <= inline_capacity) {
+                if (n != 0) {
+                    traits_type::copy(storage_.chars, str, n);
+                }
+                storage_.chars[n] = value_type();
+                storage_.chars[inline_capacity] =
+                    value_type(inline_capacity - n);
+            } else {
+                impl_type *impl = impl_type::create(str, n, alloc);
+                impl->add_ref();
+                std::memcpy(storage_.chars, &impl, sizeof(impl));
+                storage_.chars[inline_capacity] = heap_marker;
+            }
+        }
     };
 
+    template <class C, class T, class N, class A>
+    typename basic_string_ptr<C, T, N, A>::size_type const
+    basic_string_ptr<C, T, N, A>::inline_capacity;
+
+    template <class C, class T, class N, class A>
+    typename basic_string_ptr<C, T, N, A>::value_type const
+    basic_string_ptr<C, T, N, A>::heap_marker;
+
     template <class C, class T, class N, class A>
     bool operator==(basic_string_ptr<C, T, N, A> const &left,
                     basic_string_ptr<C, T, N, A> const &right)
     {
-        return (left.size() == right.size() &&
-                std::equal(left.begin(), left.end(), right.begin(), T::eq));
+        if (left.data() == right.data()) {
+            return true;
+        }
+        if (left.size() != right.size()) {
+            return false;
+        }
+
+        // Inline strings compute their hash on each call, which costs more
+        // than comparing them.
+        if (detail::is_exact_char_traits<T>::value && !left.is_inline() &&
+            !right.is_inline() && left.hash() != right.hash())
+        {
+            return false;
+        }
+        return detail::string_compare<T>::equal(left.begin(), left.end(),
+                                                right.begin(), right.end());
     }
 
     template <class C, class T, class N, class A>
@@ -99,8 +247,7 @@ namespace elemel {
     bool operator<(basic_string_ptr<C, T, N, A> const &left,
                    basic_string_ptr<C, T, N, A> const &right)
     {
-        return std::lexicographical_compare(left.begin(), left.end(),
-                                            right.begin(), right.end(), T::lt);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T, class N, class A>
@@ -128,8 +275,8 @@ namespace elemel {
     bool operator==(basic_string_ptr<C, T, N, A> const &left, C const *right)
     {
         assert(right);
-        std::size_t n = T::length(right);
-        return left.size() == n && std::equal(left.begin(), left.end(), right);
+        return detail::string_compare<T>::equal_terminated(left.begin(),
+                                                           left.end(), right);
     }
 
     template <class C, class T, class N, class A>
@@ -141,10 +288,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator<(basic_string_ptr<C, T, N, A> const &left, C const *right)
     {
-        assert(right);
-        return std::lexicographical_compare(left.begin(), left.end(),
-                                            right, right + T::length(right),
-                                            T::lt);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T, class N, class A>
@@ -168,9 +312,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator==(C const *left, basic_string_ptr<C, T, N, A> const &right)
     {
-        assert(left);
-        std::size_t n = T::length(left);
-        return n == right.size() && std::equal(left, left + n, right.begin());
+        return right == left;
     }
 
     template <class C, class T, class N, class A>
@@ -182,10 +324,7 @@ namespace elemel {
     template <class C, class T, class N, class A>
     bool operator<(C const *left, basic_string_ptr<C, T, N, A> const &right)
     {
-        assert(left);
-        return std::lexicographical_compare(left, left + T::length(left),
-                                            right.begin(), right.end(),
-                                            T::lt);
+        return right.compare(left) > 0;
     }
 
     template <class C, class T, class N, class A>
@@ -206,8 +345,46 @@ namespace elemel {
         return right < left;
     }
 
+    namespace detail {
+        template <class C, class T, class N, class A>
+        struct three_way_compare<std::less<basic_string_ptr<C, T, N, A> > > :
+            true_type
+        {
+            typedef basic_string_ptr<C, T, N, A> string_type;
+
+            static int compare(std::less<string_type> const &comp,
+                               string_type const &left,
+                               string_type const &right)
+            {
+                return left.compare(right);
+            }
+        };
+    }
+
+    // Inline strings hold no pointers into themselves.
+    template <class C, class T, class N, class A>
+    struct is_trivially_relocatable<basic_string_ptr<C, T, N, A> > :
+        detail::true_type
+    { };
+
     typedef basic_string_ptr<char> string_ptr;
     typedef basic_string_ptr<wchar_t> wstring_ptr;
 }
 
+namespace std {
+    namespace tr1 {
+        // Hashes the characters with hash_string().
+        template <class C, class T, class N, class A>
+        struct hash<elemel::basic_string_ptr<C, T, N, A> > {
+            typedef elemel::basic_string_ptr<C, T, N, A> argument_type;
+            typedef size_t result_type;
+
+            size_t operator()(argument_type const &arg) const
+            {
+                return arg.hash();
+            }
+        };
+    }
+}
+
 #endif // ELEMEL_STRING_PTR_HPP
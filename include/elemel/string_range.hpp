@@ -1,11 +1,22 @@
 #ifndef ELEMEL_STRING_RANGE_HPP
 #define ELEMEL_STRING_RANGE_HPP
 
+#include <elemel/detail/string_compare.hpp>
+#include <elemel/detail/string_search.hpp>
+#include <elemel/detail/type_traits.hpp>
+
 #include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 
 namespace elemel {
+    template <class Char, class Traits>
+    class basic_split_range;
+
     template <class Char, class Traits = std::char_traits<Char> >
     class basic_string_range {
     public:
@@ -16,6 +27,8 @@ namespace elemel {
         typedef value_type const &const_reference;
         typedef value_type const *const_iterator;
 
+        static size_type const npos = size_type(-1);
+
         basic_string_range() :
             first_(0),
             last_(0)
@@ -48,7 +61,7 @@ namespace elemel {
 
         bool empty() const
         {
-            return first_ != last_;
+            return first_ == last_;
         }
 
         const_iterator begin() const
@@ -87,17 +100,214 @@ namespace elemel {
             return first_[index];
         }
 
+        // Returns a negative number, zero or a positive number if this range
+        // is ordered before, with or after the other string.
+        int compare(basic_string_range const &other) const
+        {
+            return detail::string_compare<Traits>::compare(
+                first_, last_, other.first_, other.last_);
+        }
+
+        int compare(const_pointer str) const
+        {
+            return detail::string_compare<Traits>::compare_terminated(
+                first_, last_, str);
+        }
+
+        basic_string_range substr(size_type pos, size_type n = npos) const
+        {
+            if (pos > size()) {
+                throw std::out_of_range("position out of range");
+            }
+            return basic_string_range(first_ + pos,
+                                      first_ + pos + std::min(n, size() - pos));
+        }
+
+        size_type find(value_type c, size_type pos = 0) const
+        {
+            if (pos >= size()) {
+                return npos;
+            }
+            return offset(search_type::find(first_ + pos, last_, c));
+        }
+
+        size_type find(basic_string_range const &str, size_type pos = 0) const
+        {
+            if (pos > size()) {
+                return npos;
+            }
+            return offset(search_type::find(first_ + pos, last_, str.first_,
+                                            str.size()));
+        }
+
+        // Finds the last occurrence that starts at or before pos.
+        size_type rfind(value_type c, size_type pos = npos) const
+        {
+            size_type n = pos < size() ? pos + 1 : size();
+            return offset(search_type::rfind(first_, first_ + n, c));
+        }
+
+        size_type rfind(basic_string_range const &str,
+                        size_type pos = npos) const
+        {
+            if (str.size() > size()) {
+                return npos;
+            }
+            size_type n = std::min(pos, size() - str.size()) + str.size();
+            return offset(search_type::rfind(first_, first_ + n, str.first_,
+                                             str.size()));
+        }
+
+        size_type find_first_of(basic_string_range const &set,
+                                size_type pos = 0) const
+        {
+            if (pos >= size()) {
+                return npos;
+            }
+            return offset(search_type::find_first_of(first_ + pos, last_,
+                                                     set.first_, set.size()));
+        }
+
+        // Splits the range at each delimiter, without allocating. Adjacent
+        // delimiters give empty slices, and an empty range gives a single
+        // empty slice.
+        basic_split_range<Char, Traits> split(value_type delimiter) const
+        {
+            return basic_split_range<Char, Traits>(*this, delimiter);
+        }
+
     private:
+        typedef detail::string_search<Traits> search_type;
+
         const_pointer first_;
         const_pointer last_;
+
+        size_type offset(const_pointer p) const
+        {
+            return p ? size_type(p - first_) : npos;
+        }
+    };
+
+    template <class Char, class Traits>
+    typename basic_string_range<Char, Traits>::size_type const
+        basic_string_range<Char, Traits>::npos;
+
+    // The slices of a string range between delimiters.
+    template <class Char, class Traits = std::char_traits<Char> >
+    class basic_split_range {
+    public:
+        typedef basic_string_range<Char, Traits> value_type;
+
+        class const_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef typename basic_split_range::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef value_type const *pointer;
+            typedef value_type const &reference;
+
+            const_iterator() :
+                last_(0),
+                delimiter_(),
+                done_(true)
+            { }
+
+            reference operator*() const
+            {
+                return slice_;
+            }
+
+            pointer operator->() const
+            {
+                return &slice_;
+            }
+
+            const_iterator &operator++()
+            {
+                if (slice_.end() == last_) {
+                    slice_ = value_type();
+                    done_ = true;
+                } else {
+                    slice_ = next(slice_.end() + 1);
+                }
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator result(*this);
+                ++*this;
+                return result;
+            }
+
+            friend bool operator==(const_iterator const &left,
+                                   const_iterator const &right)
+            {
+                return (left.done_ == right.done_ &&
+                        (left.done_ || left.slice_.end() == right.slice_.end()));
+            }
+
+            friend bool operator!=(const_iterator const &left,
+                                   const_iterator const &right)
+            {
+                return !(left == right);
+            }
+
+        private:
+            friend class basic_split_range;
+
+            typedef typename value_type::const_pointer const_pointer;
+
+            value_type slice_;
+            const_pointer last_;
+            Char delimiter_;
+            bool done_;
+
+            const_iterator(value_type const &str, Char delimiter) :
+                last_(str.end()),
+                delimiter_(delimiter),
+                done_(false)
+            {
+                slice_ = next(str.begin());
+            }
+
+            value_type next(const_pointer first) const
+            {
+                const_pointer p =
+                    detail::string_search<Traits>::find(first, last_,
+                                                        delimiter_);
+                return value_type(first, p ? p : last_);
+            }
+        };
+
+        typedef const_iterator iterator;
+
+        basic_split_range(value_type const &str, Char delimiter) :
+            str_(str),
+            delimiter_(delimiter)
+        { }
+
+        const_iterator begin() const
+        {
+            return const_iterator(str_, delimiter_);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator();
+        }
+
+    private:
+        value_type str_;
+        Char delimiter_;
     };
 
     template <class C, class T>
     bool operator==(basic_string_range<C, T> const &left,
                     basic_string_range<C, T> const &right)
     {
-        return (left.size() == right.size() &&
-                std::equal(left.begin(), left.end(), right.begin(), T::eq));
+        return detail::string_compare<T>::equal(left.begin(), left.end(),
+                                                right.begin(), right.end());
     }
 
     template <class C, class T>
@@ -111,8 +321,7 @@ namespace elemel {
     bool operator<(basic_string_range<C, T> const &left,
                    basic_string_range<C, T> const &right)
     {
-        return std::lexicographical_compare(left.begin(), left.end(),
-                                            right.begin(), right.end(), T::lt);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T>
@@ -139,7 +348,8 @@ namespace elemel {
     template <class C, class T>
     bool operator==(basic_string_range<C, T> const &left, C const *right)
     {
-        return left == basic_string_range<C, T>(right);
+        return detail::string_compare<T>::equal_terminated(left.begin(),
+                                                           left.end(), right);
     }
 
     template <class C, class T>
@@ -151,7 +361,7 @@ namespace elemel {
     template <class C, class T>
     bool operator<(basic_string_range<C, T> const &left, C const *right)
     {
-        return left < basic_string_range<C, T>(right);
+        return left.compare(right) < 0;
     }
 
     template <class C, class T>
@@ -175,7 +385,7 @@ namespace elemel {
     template <class C, class T>
     bool operator==(C const *left, basic_string_range<C, T> const &right)
     {
-        return basic_string_range<C, T>(left) == right;
+        return right == left;
     }
 
     template <class C, class T>
@@ -187,7 +397,7 @@ namespace elemel {
     template <class C, class T>
     bool operator<(C const *left, basic_string_range<C, T> const &right)
     {
-        return basic_string_range<C, T>(left) < right;
+        return right.compare(left) > 0;
     }
 
     template <class C, class T>
@@ -208,8 +418,27 @@ namespace elemel {
         return right < left;
     }
 
+    namespace detail {
+        template <class C, class T>
+        struct three_way_compare<std::less<basic_string_range<C, T> > > :
+            true_type
+        {
+            typedef basic_string_range<C, T> string_type;
+
+            static int compare(std::less<string_type> const &comp,
+                               string_type const &left,
+                               string_type const &right)
+            {
+                return left.compare(right);
+            }
+        };
+    }
+
     typedef basic_string_range<char> string_range;
     typedef basic_string_range<wchar_t> wstring_range;
+
+    typedef basic_split_range<char> split_range;
+    typedef basic_split_range<wchar_t> wsplit_range;
 }
 
 #endif // ELEMEL_STRING_RANGE_HPP
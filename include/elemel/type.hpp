@@ -76,12 +76,13 @@ namespace elemel {
 namespace std {
     namespace tr1 {
         template <>
-        struct hash<elemel::type> :
-            unary_function<elemel::type, size_t>
-        {
+        struct hash<elemel::type> {
+            typedef elemel::type argument_type;
+            typedef size_t result_type;
+
             size_t operator()(elemel::type const &arg) const
             {
-                return elemel::hash_string(arg.name());
+                return elemel::hash_string(arg.info().name());
             }
         };
     }
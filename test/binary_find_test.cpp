@@ -0,0 +1,92 @@
+#include <elemel/binary_find.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <vector>
+
+template <class T>
+void test_lower_bound()
+{
+    for (int n = 0; n < 100; ++n) {
+        std::vector<T> values;
+        for (int i = 0; i < n; ++i) {
+            values.push_back(T(std::rand() % 50));
+        }
+        std::sort(values.begin(), values.end());
+        T const *first = values.empty() ? 0 : &values[0];
+        T const *last = first + values.size();
+        for (int i = -1; i <= 50; ++i) {
+            T value = T(i);
+            T const *expected = std::lower_bound(first, last, value);
+            assert(elemel::lower_bound(first, last, value) == expected);
+            assert(elemel::lower_bound(first, last, value, std::less<T>()) ==
+                   expected);
+            assert(elemel::lower_bound(values.begin(), values.end(), value,
+                                       std::less<T>()) ==
+                   values.begin() + (expected - first));
+        }
+    }
+}
+
+void test_binary_find()
+{
+    int values[] = { 1, 3, 3, 5, 8 };
+    int *first = values;
+    int *last = values + 5;
+    assert(elemel::binary_find(first, last, 0) == last);
+    assert(elemel::binary_find(first, last, 1) == first);
+    assert(elemel::binary_find(first, last, 2) == last);
+    assert(elemel::binary_find(first, last, 3) == first + 1);
+    assert(elemel::binary_find(first, last, 8) == first + 4);
+    assert(elemel::binary_find(first, last, 9) == last);
+    assert(elemel::binary_find(first, last, 8, std::less<int>()) ==
+           first + 4);
+
+    std::list<int> list(first, last);
+    assert(elemel::binary_find(list.begin(), list.end(), 5) ==
+           --(--list.end()));
+    assert(elemel::binary_find(list.begin(), list.end(), 4) == list.end());
+}
+
+void test_binary_find_many()
+{
+    std::vector<int> values;
+    for (int i = 0; i < 500; ++i) {
+        values.push_back(3 * i);
+    }
+    std::vector<int> keys;
+    for (int i = 0; i < 300; ++i) {
+        keys.push_back(std::rand() % 1600 - 50);
+    }
+    for (int sorted = 0; sorted < 2; ++sorted) {
+        if (sorted) {
+            std::sort(keys.begin(), keys.end());
+        }
+        std::vector<std::vector<int>::iterator> results;
+        elemel::binary_find_many(values.begin(), values.end(), keys.begin(),
+                                 keys.end(), std::back_inserter(results));
+        assert(results.size() == keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            assert(results[i] == elemel::binary_find(values.begin(),
+                                                     values.end(), keys[i]));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    test_lower_bound<int>();
+    test_lower_bound<unsigned int>();
+    test_lower_bound<long>();
+    test_lower_bound<long long>();
+    test_lower_bound<short>();
+    test_lower_bound<float>();
+    test_lower_bound<double>();
+    test_binary_find();
+    test_binary_find_many();
+    return 0;
+}
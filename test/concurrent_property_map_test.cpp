@@ -0,0 +1,140 @@
+#include <elemel/detail/config.hpp>
+
+#if !defined(ELEMEL_NO_CXX11)
+#include <elemel/concurrent_property_map.hpp>
+#include <elemel/shaped_storage.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef elemel::concurrent_property_map<std::string, std::string> map_type;
+
+static_assert(elemel::is_concurrently_readable<
+                  elemel::flat_map<std::string, std::string> >::value, "");
+static_assert(!elemel::is_concurrently_readable<
+                  elemel::shaped_storage<std::string, std::string> >::value,
+              "");
+
+// Counts the live values, to check that old snapshots are reclaimed.
+std::atomic<int> live(0);
+
+struct counted {
+    int value;
+
+    explicit counted(int value = 0) :
+        value(value)
+    {
+        ++live;
+    }
+
+    counted(counted const &other) :
+        value(other.value)
+    {
+        ++live;
+    }
+
+    counted &operator=(counted const &other)
+    {
+        value = other.value;
+        return *this;
+    }
+
+    ~counted()
+    {
+        --live;
+    }
+};
+
+void test_prototype()
+{
+    map_type prototype;
+    map_type instance(&prototype);
+    assert(instance.prototype() == &prototype && instance.empty());
+    prototype.set("left", "red");
+    prototype.set("right", "blue");
+    instance.set("right", "black");
+    assert(instance.get("left") == "red");
+    assert(instance.get("right") == "black");
+    assert(instance.get_local("right") == "black");
+    assert(instance.size() == 1);
+
+    {
+        map_type::read_guard guard;
+        assert(instance.get_ptr("top") == 0);
+        assert(instance.get_local_ptr("left") == 0);
+        assert(*instance.get_ptr("left") == "red");
+    }
+    try {
+        instance.get("top");
+        assert(false);
+    } catch (std::out_of_range const &) { }
+
+    assert(instance.erase("right") == 1 && instance.erase("right") == 0);
+    assert(instance.get("right") == "blue");
+    instance.prototype(0);
+    {
+        map_type::read_guard guard;
+        assert(instance.get_ptr("right") == 0);
+    }
+}
+
+// Readers see the values of a prototype change in order while a writer
+// keeps publishing new ones.
+void test_threads()
+{
+    typedef elemel::concurrent_property_map<std::string, counted> counted_map;
+    {
+        counted_map prototype;
+        counted_map instance(&prototype);
+        prototype.set("count", counted(0));
+        instance.set("local", counted(-1));
+
+        std::atomic<bool> done(false);
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.push_back(std::thread([&]() {
+                int previous = 0;
+                while (!done.load()) {
+                    counted_map::read_guard guard;
+                    counted const *count = instance.get_ptr("count");
+                    assert(count && count->value >= previous);
+                    previous = count->value;
+                    assert(instance.get_ptr("local")->value == -1);
+                }
+            }));
+        }
+        for (int i = 1; i <= 2000; ++i) {
+            prototype.set("count", counted(i));
+            if (i % 100 == 0) {
+                prototype.set("other", counted(i));
+                prototype.erase("other");
+            }
+        }
+        done.store(true);
+        for (std::size_t i = 0; i < readers.size(); ++i) {
+            readers[i].join();
+        }
+        assert(instance.get("count").value == 2000);
+    }
+
+    elemel::detail::epoch_domain::instance().collect();
+    assert(live.load() == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    test_prototype();
+    test_threads();
+    return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+    return 0;
+}
+#endif
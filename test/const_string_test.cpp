@@ -1,7 +1,13 @@
 #include <elemel/const_string.hpp>
+#include <elemel/flat_map.hpp>
+#include <elemel/intern.hpp>
+#include <elemel/ref_count.hpp>
 
 #include <cassert>
+#include <cctype>
+#include <functional>
 #include <string>
+#include <vector>
 
 void test_compare()
 {
@@ -69,8 +75,160 @@ void test_compare()
     assert("foo" > elemel::const_string("bar"));
 }
 
+template <class RefCount>
+void test_ref_count()
+{
+    typedef elemel::basic_const_string<char, std::char_traits<char>, RefCount> string_type;
+    string_type a("foo");
+    {
+        string_type b(a);
+        string_type c("bar");
+        c = b;
+        c.share();
+        string_type d(c);
+        assert(d == "foo");
+    }
+    assert(a == "foo");
+}
+
+void test_intern()
+{
+    std::string foo("foo");
+    elemel::const_string a = elemel::intern("foo");
+    elemel::const_string b = elemel::intern(foo.c_str());
+    assert(a.interned() && b.interned());
+    assert(a.data() == b.data());
+    assert(a == b && a == "foo");
+    assert(elemel::intern("bar") != a);
+    assert(elemel::intern(elemel::const_string("foo")).data() == a.data());
+    assert(!elemel::const_string("foo").interned());
+    assert(elemel::const_string("foo") == a);
+    assert(elemel::intern(L"foo") == elemel::intern(L"foo"));
+
+    elemel::flat_map<elemel::const_string, int, elemel::interned_less> m;
+    for (int i = 0; i < 1000; ++i) {
+        std::string name(1 + i % 100, 'a' + i % 100 % 26);
+        m[elemel::intern(name.c_str())] = i % 100;
+    }
+    assert(m.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        std::string name(1 + i, 'a' + i % 26);
+        assert(m[elemel::intern(name.c_str())] == i);
+    }
+}
+
+struct ci_char_traits : std::char_traits<char> {
+    static bool eq(char left, char right)
+    {
+        return std::tolower(left) == std::tolower(right);
+    }
+
+    static bool lt(char left, char right)
+    {
+        return std::tolower(left) < std::tolower(right);
+    }
+
+    static int compare(char const *left, char const *right, std::size_t n)
+    {
+        for (std::size_t i = 0; i != n; ++i) {
+            if (!eq(left[i], right[i])) {
+                return lt(left[i], right[i]) ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+};
+
+void test_intern_ci()
+{
+    typedef elemel::basic_const_string<char, ci_char_traits> string_type;
+    string_type a = elemel::intern(string_type("foo"));
+    string_type b = elemel::intern(string_type("FOO"));
+    assert(a.interned() && b.interned());
+    assert(a.data() != b.data());
+    assert(a == b);
+}
+
+void test_hash()
+{
+    elemel::const_string a("foo");
+    elemel::const_string b(std::string("foo").c_str());
+    assert(a.hash() == b.hash());
+    assert(a.hash() == elemel::hash_string("foo"));
+    assert(a.hash() != elemel::const_string("bar").hash());
+
+    elemel::const_string c("foo", elemel::by_ref);
+    assert(!c.hash_cached() && a.hash_cached());
+    assert(c.hash() == a.hash());
+    assert(c == a && a == c);
+}
+
+int sign(int n)
+{
+    return (n > 0) - (n < 0);
+}
+
+template <class String>
+void test_three_way()
+{
+    typedef typename String::value_type char_type;
+    typedef std::basic_string<char_type> string_type;
+
+    string_type strs[] = {
+        string_type(), string_type(1, char_type('a')),
+        string_type(1, char_type(200)), string_type(20, char_type('a')),
+        string_type(19, char_type('a')) + char_type('b'),
+        string_type(21, char_type('a'))
+    };
+    std::size_t n = sizeof(strs) / sizeof(*strs);
+    for (std::size_t i = 0; i != n; ++i) {
+        String a(strs[i].c_str(), strs[i].size());
+        for (std::size_t j = 0; j != n; ++j) {
+            String b(strs[j].c_str(), strs[j].size());
+            int expected = sign(strs[i].compare(strs[j]));
+            assert(sign(a.compare(b)) == expected);
+            assert(sign(a.compare(strs[j].c_str())) == expected);
+            assert((a == b) == (expected == 0));
+            assert((a < b) == (expected < 0));
+        }
+    }
+    assert(elemel::detail::three_way_compare<std::less<String> >::value);
+}
+
+// Maps keyed on strings are searched with three-way comparisons.
+void test_flat_map()
+{
+    typedef elemel::flat_map<elemel::const_string, int> map_type;
+
+    assert(elemel::detail::three_way_compare<
+           map_type::compare>::value);
+
+    map_type m;
+    std::vector<elemel::const_string> keys;
+    for (int i = 0; i < 200; ++i) {
+        std::string key(i % 17 + 1, char('a' + i % 26));
+        keys.push_back(elemel::const_string(key.c_str()));
+        m[keys.back()] = i;
+    }
+    for (int i = 0; i < 200; ++i) {
+        map_type::iterator j = m.find(keys[i]);
+        assert(j != m.end() && j->first == keys[i]);
+    }
+    assert(m.find(elemel::const_string("not a key")) == m.end());
+    assert(m.find(elemel::const_string("")) == m.end());
+}
+
 int main(int argc, char *argv[])
 {
     test_compare();
+    test_ref_count<long>();
+    test_ref_count<elemel::atomic_ref_count>();
+    test_ref_count<elemel::deferred_ref_count>();
+    test_hash();
+    test_intern();
+    test_intern_ci();
+    test_three_way<elemel::const_string>();
+    test_three_way<elemel::const_wstring>();
+    test_flat_map();
     return 0;
 }
@@ -0,0 +1,319 @@
+#include <elemel/const_string.hpp>
+#include <elemel/copying_vector.hpp>
+#include <elemel/malloc_allocator.hpp>
+#include <elemel/small_copying_vector.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct counted {
+    static int copies;
+    static int moves;
+    static int live;
+
+    int value;
+
+    counted(int value = 0) :
+        value(value)
+    {
+        ++live;
+    }
+
+    counted(counted const &other) :
+        value(other.value)
+    {
+        ++copies;
+        ++live;
+    }
+
+#if __cplusplus >= 201103L
+    counted(counted &&other) noexcept :
+        value(other.value)
+    {
+        ++moves;
+        ++live;
+    }
+
+    counted &operator=(counted &&other) noexcept
+    {
+        value = other.value;
+        ++moves;
+        return *this;
+    }
+#endif
+
+    counted &operator=(counted const &other)
+    {
+        value = other.value;
+        ++copies;
+        return *this;
+    }
+
+    ~counted()
+    {
+        --live;
+    }
+};
+
+bool operator==(counted const &a, counted const &b)
+{
+    return a.value == b.value;
+}
+
+int counted::copies = 0;
+int counted::moves = 0;
+int counted::live = 0;
+
+void test_push_back()
+{
+    {
+        elemel::copying_vector<counted> v;
+        for (int i = 0; i < 100; ++i) {
+            v.push_back(counted(i));
+        }
+        for (int i = 0; i < 100; ++i) {
+            assert(v[i].value == i);
+        }
+
+        // The pushed value may live in the storage that is replaced.
+        while (v.size() != v.capacity()) {
+            v.push_back(counted(1));
+        }
+        v.push_back(v.front());
+        assert(v.back().value == 0);
+    }
+    assert(counted::live == 0);
+}
+
+void test_insert()
+{
+    {
+        elemel::copying_vector<counted> v;
+        for (int i = 0; i < 50; ++i) {
+            v.insert(v.begin() + v.size() / 2, counted(i));
+        }
+        assert(v.size() == 50);
+        v.insert(v.begin(), v.back());
+        assert(v.front().value == v.back().value);
+        v.reserve(v.size() + 1);
+        v.insert(v.begin() + 1, v.back());
+        assert(v[1].value == v.back().value);
+    }
+    assert(counted::live == 0);
+}
+
+void test_move()
+{
+#if __cplusplus >= 201103L
+    counted::copies = 0;
+    {
+        elemel::copying_vector<counted> v;
+        for (int i = 0; i < 100; ++i) {
+            v.emplace_back(i);
+        }
+        v.emplace(v.begin() + 10, -1);
+        v.insert(v.begin() + 20, counted(-2));
+        assert(v[10].value == -1);
+        assert(v[20].value == -2);
+        assert(v[21].value == 19);
+
+        elemel::copying_vector<counted> w(std::move(v));
+        assert(v.empty());
+        assert(w.size() == 102);
+        v = std::move(w);
+        assert(v.size() == 102);
+    }
+    assert(counted::copies == 0);
+    assert(counted::live == 0);
+
+    elemel::copying_vector<std::string> strings;
+    for (int i = 0; i < 100; ++i) {
+        strings.push_back(std::string(100, char('a' + i % 26)));
+    }
+    assert(strings[99] == std::string(100, char('a' + 99 % 26)));
+
+    // Nested vectors move when std::vector grows.
+    static_assert(std::is_nothrow_move_constructible<
+                      elemel::copying_vector<std::string> >::value, "");
+    static_assert(std::is_nothrow_move_constructible<
+                      elemel::small_copying_vector<std::string, 4> >::value,
+                  "");
+    std::vector<elemel::copying_vector<counted> > nested(1);
+    nested[0].push_back(counted(1));
+    counted::copies = 0;
+    nested.resize(100);
+    assert(counted::copies == 0 && nested[0][0].value == 1);
+#endif
+}
+
+void test_trivially_relocatable()
+{
+    elemel::copying_vector<std::pair<int, int *> > v;
+    std::vector<std::pair<int, int *> > expected;
+    int x = 0;
+    for (int i = 0; i < 100; ++i) {
+        v.insert(v.begin() + v.size() / 3, std::make_pair(i, &x));
+        expected.insert(expected.begin() + expected.size() / 3,
+                        std::make_pair(i, &x));
+    }
+    v.reserve(1000);
+    assert(v.size() == expected.size());
+    assert(std::equal(v.begin(), v.end(), expected.begin()));
+
+    elemel::copying_vector<elemel::const_string> strings;
+    for (int i = 0; i < 100; ++i) {
+        strings.insert(strings.begin(), elemel::const_string("foo"));
+    }
+    assert(strings.size() == 100);
+    assert(strings.back() == "foo");
+}
+
+template <class T>
+T make_value(int i)
+{
+    return T(i);
+}
+
+template <>
+std::string make_value<std::string>(int i)
+{
+    return std::string(i, 'x');
+}
+
+template <class Vector>
+void test_insert_erase_range()
+{
+    typedef typename Vector::value_type value_type;
+    {
+        Vector v;
+        std::vector<value_type> expected;
+        for (int i = 0; i < 200; ++i) {
+            int n = std::rand() % 10;
+            std::vector<value_type> values;
+            for (int j = 0; j < n; ++j) {
+                values.push_back(make_value<value_type>(std::rand() % 100));
+            }
+            int index = std::rand() % (expected.size() + 1);
+            v.insert(v.begin() + index, values.begin(), values.end());
+            expected.insert(expected.begin() + index, values.begin(),
+                            values.end());
+            if (i % 3 == 0 && !expected.empty()) {
+                int first = std::rand() % expected.size();
+                int last = first + std::rand() % (expected.size() - first);
+                v.erase(v.begin() + first, v.begin() + last);
+                expected.erase(expected.begin() + first,
+                               expected.begin() + last);
+                v.erase(v.begin() + first);
+                expected.erase(expected.begin() + first);
+            }
+            assert(v.size() == expected.size());
+            assert(std::equal(v.begin(), v.end(), expected.begin()));
+        }
+        assert(v.erase(v.begin(), v.end()) == v.end());
+        assert(v.empty());
+    }
+    assert(counted::live == 0);
+}
+
+void test_insert_input_range()
+{
+    elemel::copying_vector<int> v(2, 0);
+    std::istringstream in("1 2 3");
+    v.insert(v.begin() + 1, std::istream_iterator<int>(in),
+             std::istream_iterator<int>());
+    assert(v.size() == 5);
+    assert(v[0] == 0 && v[1] == 1 && v[3] == 3 && v[4] == 0);
+}
+
+template <class T>
+void test_malloc_allocator(T const &value)
+{
+    elemel::copying_vector<T, elemel::malloc_allocator<T> > v;
+    std::vector<T> expected;
+    for (int i = 0; i < 1000; ++i) {
+        v.push_back(value);
+        expected.push_back(value);
+        if (i % 7 == 0) {
+            v.insert(v.begin() + i / 2, v.back());
+            expected.insert(expected.begin() + i / 2, expected.back());
+        }
+    }
+    v.reserve(v.capacity() * 2);
+    assert(v.size() == expected.size());
+    assert(std::equal(v.begin(), v.end(), expected.begin()));
+}
+
+template <class Vector>
+bool is_inline(Vector const &v)
+{
+    char const *p = reinterpret_cast<char const *>(v.begin());
+    return p >= reinterpret_cast<char const *>(&v) &&
+        p < reinterpret_cast<char const *>(&v + 1);
+}
+
+void test_small()
+{
+    typedef elemel::small_copying_vector<counted, 4> small_vector;
+    {
+        small_vector v;
+        assert(v.capacity() == 4);
+        for (int i = 0; i < 4; ++i) {
+            v.insert(v.begin(), counted(i));
+        }
+        assert(is_inline(v));
+        assert(v.front().value == 3 && v.back().value == 0);
+
+        small_vector w(v);
+        assert(is_inline(w));
+        w.push_back(counted(4));
+        assert(!is_inline(w));
+        assert(w.size() == 5 && w[4].value == 4);
+
+        v.swap(w);
+        assert(v.size() == 5 && !is_inline(v));
+        assert(w.size() == 4 && is_inline(w));
+        assert(w.back().value == 0);
+
+        small_vector x(2, counted(7));
+        x = w;
+        assert(is_inline(x));
+        assert(std::equal(x.begin(), x.end(), w.begin()));
+        x = v;
+        assert(x.size() == 5);
+        assert(std::equal(x.begin(), x.end(), v.begin()));
+#if __cplusplus >= 201103L
+        small_vector y(std::move(w));
+        assert(is_inline(y) && y.size() == 4 && w.empty());
+        small_vector z(std::move(v));
+        assert(!is_inline(z) && z.size() == 5 && v.empty());
+        z = std::move(y);
+        assert(z.size() == 4 && z.back().value == 0 && y.empty());
+#endif
+    }
+    assert(counted::live == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    test_push_back();
+    test_insert();
+    test_move();
+    test_trivially_relocatable();
+    test_malloc_allocator(std::make_pair(1, static_cast<int *>(0)));
+    test_malloc_allocator(std::string(100, 'x'));
+    test_small();
+    test_insert_erase_range<elemel::copying_vector<int> >();
+    test_insert_erase_range<elemel::copying_vector<counted> >();
+    test_insert_erase_range<elemel::copying_vector<std::string> >();
+    test_insert_erase_range<elemel::small_copying_vector<counted, 8> >();
+    test_insert_erase_range<
+        elemel::copying_vector<int, elemel::malloc_allocator<int> > >();
+    test_insert_input_range();
+    return 0;
+}
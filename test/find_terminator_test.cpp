@@ -0,0 +1,46 @@
+#include <elemel/find_terminator.hpp>
+
+#include <cassert>
+#include <list>
+#include <string>
+#include <vector>
+
+// Checks every start offset and length, so that the terminator lands at
+// every position within the aligned blocks.
+template <class Char>
+void test_find_terminator()
+{
+    std::vector<Char> buffer(200, Char('x'));
+    for (std::size_t first = 0; first < 64; ++first) {
+        for (std::size_t n = 0; first + n < buffer.size(); ++n) {
+            buffer[first + n] = Char();
+            Char *p = &buffer[first];
+            Char const *q = p;
+            assert(elemel::find_terminator(p) == p + n);
+            assert(elemel::find_terminator(q) == q + n);
+            assert(elemel::find_terminator(q, Char()) == q + n);
+            buffer[first + n] = Char('x');
+        }
+    }
+
+    buffer[150] = Char('y');
+    assert(elemel::find_terminator(&buffer[3], Char('y')) == &buffer[150]);
+    assert(elemel::find_terminator(&buffer[150], Char('y')) == &buffer[150]);
+}
+
+void test_iterators()
+{
+    char const str[] = "foo;bar";
+    std::list<char> chars(str, str + sizeof(str));
+    assert(*elemel::find_terminator(chars.begin(), ';') == ';');
+    assert(std::distance(chars.begin(),
+                         elemel::find_terminator(chars.begin())) == 7);
+}
+
+int main(int argc, char *argv[])
+{
+    test_find_terminator<char>();
+    test_find_terminator<wchar_t>();
+    test_iterators();
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include <elemel/eytzinger_layout.hpp>
+#include <elemel/flat_map.hpp>
+#include <elemel/split_flat_map.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <vector>
+
+template <class Map>
+void test_find()
+{
+    Map m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        int key = std::rand() % 2000;
+        m[key] = i;
+        expected[key] = i;
+    }
+    assert(m.size() == expected.size());
+    for (int key = -1; key <= 2000; ++key) {
+        typename Map::iterator i = m.find(key);
+        std::map<int, int>::iterator j = expected.find(key);
+        if (j == expected.end()) {
+            assert(i == m.end());
+        } else {
+            assert(i != m.end());
+            assert(i->first == key);
+            assert(i->second == j->second);
+        }
+    }
+}
+
+void test_find_eytzinger_sizes()
+{
+    // Exercise every tree shape up to a few complete levels.
+    for (int n = 0; n < 70; ++n) {
+        elemel::flat_map<int, int, std::less<int>,
+                         std::allocator<std::pair<int, int> >,
+                         elemel::eytzinger_layout> m;
+        for (int i = 0; i < n; ++i) {
+            m[2 * i] = i;
+        }
+        for (int key = -1; key <= 2 * n; ++key) {
+            if (key % 2 == 0 && key < 2 * n) {
+                assert(m.find(key) != m.end());
+                assert(m.find(key)->second == key / 2);
+            } else {
+                assert(m.find(key) == m.end());
+            }
+        }
+    }
+}
+
+template <class Map>
+void test_find_many()
+{
+    Map m;
+    for (int i = 0; i < 1000; ++i) {
+        m[std::rand() % 3000] = i;
+    }
+    std::vector<int> keys;
+    for (int i = 0; i < 500; ++i) {
+        keys.push_back(std::rand() % 3100 - 50);
+    }
+    for (int sorted = 0; sorted < 2; ++sorted) {
+        if (sorted) {
+            std::sort(keys.begin(), keys.end());
+        }
+        std::vector<typename Map::const_iterator> results;
+        Map const &c = m;
+        c.find_many(keys.begin(), keys.end(), std::back_inserter(results));
+        assert(results.size() == keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            assert(results[i] == c.find(keys[i]));
+        }
+    }
+}
+
+template <class Map>
+bool equal(Map const &m, std::map<int, int> const &expected)
+{
+    if (m.size() != expected.size()) {
+        return false;
+    }
+    typename Map::const_iterator i = m.begin();
+    std::map<int, int>::const_iterator j = expected.begin();
+    for (; i != m.end(); ++i, ++j) {
+        if (i->first != j->first || i->second != j->second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Map>
+void test_insert_range()
+{
+    Map m;
+    std::map<int, int> expected;
+    for (int batch = 0; batch < 20; ++batch) {
+        std::vector<std::pair<int, int> > values;
+        for (int i = 0; i < 100; ++i) {
+            values.push_back(std::make_pair(std::rand() % 1000, batch * i));
+        }
+        m.insert(values.begin(), values.end());
+        expected.insert(values.begin(), values.end());
+        assert(equal(m, expected));
+    }
+
+    Map sorted(elemel::sorted_unique, expected.begin(), expected.end());
+    assert(equal(sorted, expected));
+
+    std::vector<std::pair<int, int> > tail;
+    tail.push_back(std::make_pair(-1, 1));
+    tail.push_back(std::make_pair(500, 2));
+    tail.push_back(std::make_pair(2000, 3));
+    sorted.insert(elemel::sorted_unique, tail.begin(), tail.end());
+    expected.insert(tail.begin(), tail.end());
+    assert(equal(sorted, expected));
+    assert(sorted.find(2000)->second == 3);
+    assert(sorted.find(-1)->second == 1);
+}
+
+template <class Map>
+void test_erase()
+{
+    Map m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 500; ++i) {
+        m[i] = i;
+        expected[i] = i;
+    }
+    for (int i = 0; i < 500; i += 3) {
+        assert(m.erase(i) == 1);
+        expected.erase(i);
+    }
+    assert(m.erase(0) == 0);
+    m.erase(m.find(1));
+    expected.erase(1);
+    m.erase(m.find(100), m.find(200));
+    expected.erase(expected.find(100), expected.find(200));
+    assert(equal(m, expected));
+    for (int key = 0; key < 500; ++key) {
+        assert((m.find(key) != m.end()) == (expected.count(key) != 0));
+    }
+}
+
+template <class Map>
+void test_max_unsorted()
+{
+    Map m;
+    m.max_unsorted(32);
+    std::map<int, int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        int key = std::rand() % 1000;
+        std::pair<typename Map::iterator, bool> result =
+            m.insert(std::make_pair(key, i));
+        assert(result.first->first == key);
+        assert(result.second == expected.insert(std::make_pair(key, i)).second);
+        assert(result.first->second == expected[key]);
+        if (i % 5 == 0) {
+            key = std::rand() % 1000;
+            typename Map::iterator j = m.find(key);
+            assert((j != m.end()) == (expected.count(key) != 0));
+            if (j != m.end()) {
+                assert(j->second == expected[key]);
+                if (i % 3 == 0) {
+                    m.erase(j);
+                    expected.erase(key);
+                }
+            }
+        }
+        if (i % 500 == 0) {
+            assert(equal(m, expected));
+        }
+    }
+
+    Map const &c = m;
+    m[-1] = 1;
+    expected[-1] = 1;
+    assert(c.find(-1)->second == 1);
+    assert(equal(c, expected));
+    m[-2] = 2;
+    expected[-2] = 2;
+    m.max_unsorted(0);
+    assert(equal(m, expected));
+}
+
+struct large {
+    int value;
+    char padding[120];
+
+    large(int value = 0) :
+        value(value)
+    { }
+};
+
+void test_split()
+{
+    typedef elemel::split_flat_map<int, large> map_type;
+    map_type m;
+    for (int i = 0; i < 100; ++i) {
+        m[i * 37 % 100].value = i;
+    }
+    assert(m.size() == 100);
+    assert(m.keys().size() == 100);
+    assert(std::adjacent_find(m.keys().begin(), m.keys().end(),
+                              std::greater_equal<int>()) == m.keys().end());
+    for (map_type::const_iterator i = m.begin(); i != m.end(); ++i) {
+        assert(i->first * 37 % 100 == m.find(i->first)->first * 37 % 100);
+        std::pair<int, large> value = *i;
+        assert(value.second.value * 37 % 100 == i->first);
+    }
+    map_type::iterator i = m.find(37);
+    i->second.value = -1;
+    assert(m[37].value == -1);
+    assert((*(i + 1)).first == 38 && i[-1].first == 36);
+    assert(m.end() - m.begin() == 100);
+    assert(m.rbegin()->first == 99);
+
+    map_type n(m);
+    n.erase(n.begin(), n.find(50));
+    assert(n.size() == 50 && n.begin()->first == 50);
+    m = n;
+    assert(m.size() == 50 && m.find(37) == m.end());
+}
+
+void test_small()
+{
+    typedef elemel::flat_map<int, int, std::less<int>,
+                             std::allocator<std::pair<int, int> >,
+                             elemel::sorted_layout, 8> small_map;
+    small_map m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 8; ++i) {
+        m[i * 7 % 8] = i;
+        expected[i * 7 % 8] = i;
+    }
+    assert(equal(m, expected));
+
+    small_map n(m);
+    n[100] = 100;
+    m.swap(n);
+    assert(m.size() == 9 && m.find(100)->second == 100);
+    assert(equal(n, expected));
+}
+
+int main(int argc, char *argv[])
+{
+    test_find<elemel::flat_map<int, int> >();
+    test_find<elemel::flat_map<int, int, std::less<int>,
+                               std::allocator<std::pair<int, int> >,
+                               elemel::eytzinger_layout> >();
+    test_find<elemel::flat_map<int, int, std::less<int>,
+                               std::allocator<std::pair<int, int> >,
+                               elemel::sorted_layout, 8> >();
+    test_find_eytzinger_sizes();
+    test_find_many<elemel::flat_map<int, int> >();
+    test_find_many<elemel::flat_map<int, int, std::less<int>,
+                                    std::allocator<std::pair<int, int> >,
+                                    elemel::eytzinger_layout> >();
+    test_insert_range<elemel::flat_map<int, int> >();
+    test_insert_range<elemel::flat_map<int, int, std::less<int>,
+                                       std::allocator<std::pair<int, int> >,
+                                       elemel::eytzinger_layout> >();
+    test_insert_range<elemel::flat_map<int, int, std::less<int>,
+                                       std::allocator<std::pair<int, int> >,
+                                       elemel::sorted_layout, 8> >();
+    test_erase<elemel::flat_map<int, int> >();
+    test_erase<elemel::flat_map<int, int, std::less<int>,
+                                std::allocator<std::pair<int, int> >,
+                                elemel::eytzinger_layout> >();
+    test_max_unsorted<elemel::flat_map<int, int> >();
+    test_max_unsorted<elemel::flat_map<int, int, std::less<int>,
+                                       std::allocator<std::pair<int, int> >,
+                                       elemel::eytzinger_layout> >();
+    typedef elemel::split_flat_map<int, int> split_map;
+    typedef elemel::split_flat_map<int, int, std::less<int>,
+                                   std::allocator<std::pair<int, int> >,
+                                   elemel::eytzinger_layout>
+        split_eytzinger_map;
+    test_find<split_map>();
+    test_find<split_eytzinger_map>();
+    test_find_many<split_map>();
+    test_find_many<split_eytzinger_map>();
+    test_insert_range<split_map>();
+    test_insert_range<split_eytzinger_map>();
+    test_erase<split_map>();
+    test_erase<split_eytzinger_map>();
+    test_split();
+    test_small();
+    return 0;
+}
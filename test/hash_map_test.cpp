@@ -0,0 +1,144 @@
+#include <elemel/const_string.hpp>
+#include <elemel/hash_map.hpp>
+#include <elemel/property_map.hpp>
+#include <elemel/string_ptr.hpp>
+#include <elemel/string_range.hpp>
+#include <elemel/type.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Checks inserts, finds and erases against std::map, including erases that
+// leave deleted slots behind.
+void test_random()
+{
+    elemel::hash_map<int, int> m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 20000; ++i) {
+        int key = std::rand() % 2000;
+        switch (std::rand() % 3) {
+        case 0:
+            m[key] = i;
+            expected[key] = i;
+            break;
+
+        case 1:
+            assert(m.erase(key) == expected.erase(key));
+            break;
+
+        default:
+            {
+                elemel::hash_map<int, int>::iterator j = m.find(key);
+                std::map<int, int>::iterator k = expected.find(key);
+                assert((j == m.end()) == (k == expected.end()));
+                assert(j == m.end() || j->second == k->second);
+            }
+            break;
+        }
+        assert(m.size() == expected.size());
+    }
+
+    std::map<int, int> values(m.begin(), m.end());
+    assert(values == expected);
+}
+
+void test_copy()
+{
+    elemel::hash_map<std::string, int> m;
+    assert(m.empty() && m.begin() == m.end());
+    assert(m.find("foo") == m.end());
+    for (int i = 0; i < 100; ++i) {
+        std::ostringstream out;
+        out << "key" << i;
+        m.insert(std::make_pair(out.str(), i));
+    }
+    assert(!m.insert(std::make_pair(std::string("key7"), 0)).second);
+
+    elemel::hash_map<std::string, int> n(m);
+    assert(n.size() == 100 && n["key42"] == 42);
+    n.erase("key42");
+    assert(m.count("key42") == 1 && n.count("key42") == 0);
+
+    m = n;
+    assert(m.size() == 99 && m.count("key42") == 0);
+    m.clear();
+    assert(m.empty() && m.begin() == m.end() && m.find("key1") == m.end());
+    std::swap(m, n);
+    assert(m.size() == 99 && n.empty());
+
+    elemel::hash_map<std::string, int> small;
+    small.reserve(3);
+    assert(small.capacity() == 4);
+    small["a"] = 1;
+    small["b"] = 2;
+    small["c"] = 3;
+    assert(small.capacity() == 4);
+    small["d"] = 4;
+    assert(small.capacity() == 8 && small["a"] == 1);
+}
+
+// Keys with equal low bits still spread over the slots.
+void test_pointers()
+{
+    std::vector<double> values(1000);
+    elemel::hash_map<double *, int> m;
+    for (int i = 0; i < 1000; ++i) {
+        m[&values[i]] = i;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        assert(m[&values[i]] == i);
+    }
+}
+
+void test_default_hashers()
+{
+    elemel::hash_map<elemel::const_string, int> strings;
+    strings[elemel::const_string("foo")] = 1;
+    assert(strings[elemel::const_string("foo", elemel::by_ref)] == 1);
+
+    elemel::hash_map<elemel::string_ptr, int> ptrs;
+    ptrs[elemel::string_ptr("a string that is stored on the heap")] = 2;
+    assert(ptrs.count(elemel::string_ptr("a string that is stored on the heap")));
+
+    elemel::hash_map<elemel::string_range, int> ranges;
+    ranges["bar"] = 3;
+    assert(ranges.count("bar") && !ranges.count("baz"));
+
+    elemel::hash_map<elemel::type, int> types;
+    types[typeid(int)] = 4;
+    assert(types.count(typeid(int)) && !types.count(typeid(long)));
+}
+
+void test_property_map()
+{
+    typedef elemel::property_map<
+        std::string, std::string,
+        elemel::hash_map<std::string, std::string>,
+        elemel::hash_map<std::string, std::string const *>
+    > map_type;
+
+    map_type prototype;
+    map_type instance(&prototype);
+    prototype.set("left", "red");
+    prototype.set("right", "blue");
+    instance.set("right", "black");
+    assert(instance.get("left") == "red");
+    assert(instance.get("right") == "black");
+    assert(instance.get_ptr("top") == 0);
+    prototype.set("top", "green");
+    assert(instance.get("top") == "green");
+}
+
+int main(int argc, char *argv[])
+{
+    test_random();
+    test_copy();
+    test_pointers();
+    test_default_hashers();
+    test_property_map();
+    return 0;
+}
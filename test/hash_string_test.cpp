@@ -0,0 +1,73 @@
+#include <elemel/hash_string.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void test_consistency()
+{
+    char const *str = "a string that is longer than sixteen bytes";
+    std::size_t n = std::char_traits<char>::length(str);
+    std::size_t hash = elemel::hash_string(str);
+    assert(elemel::hash_string(str, str + n) == hash);
+    assert(elemel::hash_string(str, n) == hash);
+    assert(elemel::hash_string(elemel::string_range(str)) == hash);
+    assert(elemel::hash_string(reinterpret_cast<unsigned char const *>(str)) ==
+           hash);
+    assert(std::size_t(elemel::hash_bytes(str, n)) == hash);
+
+    wchar_t const *wstr = L"wide";
+    assert(elemel::hash_string(wstr) == elemel::hash_string(wstr, wstr + 4));
+    assert(elemel::hash_string(wstr) == elemel::hash_string(wstr, 4));
+
+    assert(elemel::hash_string(str, n, 1) != hash);
+    assert(elemel::hash_bytes(str, n, 1) == elemel::hash_bytes(str, n, 1));
+}
+
+// Every length exercises a different path through the hash, and every bit
+// of every byte must affect the result.
+void test_lengths()
+{
+    std::vector<unsigned char> bytes(200);
+    for (std::size_t i = 0; i != bytes.size(); ++i) {
+        bytes[i] = static_cast<unsigned char>(i * 31 + 7);
+    }
+    std::set<unsigned long long> hashes;
+    for (std::size_t n = 0; n <= bytes.size(); ++n) {
+        unsigned long long hash = elemel::hash_bytes(&bytes[0], n);
+        assert(hashes.insert(hash).second);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (int bit = 0; bit < 8; ++bit) {
+                bytes[i] ^= static_cast<unsigned char>(1 << bit);
+                assert(elemel::hash_bytes(&bytes[0], n) != hash);
+                bytes[i] ^= static_cast<unsigned char>(1 << bit);
+            }
+        }
+    }
+}
+
+void test_distribution()
+{
+    std::set<unsigned long long> hashes;
+    std::set<std::size_t> buckets;
+    for (int i = 0; i < 10000; ++i) {
+        std::ostringstream out;
+        out << "key" << i;
+        std::string key = out.str();
+        unsigned long long hash = elemel::hash_bytes(key.data(), key.size());
+        assert(hashes.insert(hash).second);
+        buckets.insert(std::size_t(hash % 1024));
+    }
+    assert(buckets.size() == 1024);
+}
+
+int main(int argc, char *argv[])
+{
+    test_consistency();
+    test_lengths();
+    test_distribution();
+    return 0;
+}
@@ -1,11 +1,18 @@
+#include <elemel/hash_map.hpp>
 #include <elemel/property_map.hpp>
 
+#include <cassert>
+#include <functional>
+#include <new>
+#include <stdexcept>
 #include <string>
 
-int main(int argc, char *argv[])
+typedef elemel::property_map<std::string, std::string> map_type;
+
+void test_prototype()
 {
-    elemel::property_map<std::string, std::string> prototype;
-    elemel::property_map<std::string, std::string> instance(&prototype);
+    map_type prototype;
+    map_type instance(&prototype);
     prototype.set("left", "red");
     prototype.set("right", "blue");
     prototype.set("center", "green");
@@ -15,5 +22,197 @@ int main(int argc, char *argv[])
     assert(instance.get("bottom") == "white");
     assert(instance.get("left") == "red");
     assert(instance.get("right") == "black");
+}
+
+// Edits anywhere in a chain show through the caches of the maps below.
+void test_invalidation()
+{
+    map_type maps[5];
+    for (int i = 1; i < 5; ++i) {
+        maps[i].prototype(&maps[i - 1]);
+    }
+    maps[0].set("color", "red");
+    assert(maps[4].get("color") == "red");
+    assert(maps[4].get_ptr("size") == 0);
+
+    maps[2].set("color", "blue");
+    assert(maps[4].get("color") == "blue");
+    maps[0].set("size", "large");
+    assert(maps[4].get("size") == "large");
+    maps[2].erase("color");
+    assert(maps[4].get("color") == "red");
+    maps[3].prototype(0);
+    assert(maps[4].get_ptr("color") == 0);
+
+    // Many keys, so that the storage of the prototype moves.
+    maps[3].prototype(&maps[0]);
+    for (int i = 0; i < 100; ++i) {
+        maps[0].set(std::string(1, char('a' + i % 26)) + char('a' + i / 26),
+                    "value");
+        assert(maps[4].get("color") == "red");
+    }
+
+    map_type copy(maps[3]);
+    assert(copy.get("size") == "large");
+    copy = maps[1];
+    assert(copy.get("color") == "red");
+}
+
+void test_lookup_handle()
+{
+    map_type prototype;
+    map_type instance(&prototype);
+    map_type::lookup_handle color("color");
+    assert(color.key() == "color");
+    assert(instance.get_ptr(color) == 0);
+
+    prototype.set("color", "red");
+    assert(instance.get(color) == "red");
+    assert(&instance.get(color) == prototype.get_local_ptr("color"));
+    prototype.set("color", "green");
+    assert(instance.get(color) == "green");
+
+    instance.set("color", "blue");
+    assert(instance.get(color) == "blue");
+    assert(prototype.get(color) == "green");
+    instance.erase("color");
+    assert(instance.get(color) == "green");
+    prototype.set("size", "large");
+    assert(instance.get(color) == "green");
+
+    map_type other;
+    other.prototype(&instance);
+    assert(other.get(color) == "green");
+    other.prototype(0);
+    assert(other.get_ptr(color) == 0);
+}
+
+// A map created at the address of a destroyed map does not match the
+// handles of the destroyed one.
+void test_lookup_handle_reuse()
+{
+    map_type::lookup_handle color("color");
+    void *buffer = ::operator new(sizeof(map_type));
+    map_type *a = new (buffer) map_type;
+    a->set("color", "red");
+    assert(a->get(color) == "red");
+    a->~map_type();
+
+    map_type *b = new (buffer) map_type;
+    b->set("size", "large");
+    assert(b->get_ptr(color) == 0);
+    b->~map_type();
+    ::operator delete(buffer);
+}
+
+// Counts key comparisons, to tell cached lookups from real ones.
+struct counting_less {
+    static int count;
+
+    bool operator()(std::string const &left, std::string const &right) const
+    {
+        ++count;
+        return left < right;
+    }
+};
+
+int counting_less::count = 0;
+
+// Edits in one prototype tree leave the caches and handles of other trees
+// alone.
+void test_unrelated_edits()
+{
+    typedef elemel::property_map<
+        std::string, std::string,
+        elemel::flat_map<std::string, std::string, counting_less>,
+        elemel::flat_map<std::string, std::string const *, counting_less>
+    > counting_map;
+
+    counting_map prototype;
+    counting_map instance(&prototype);
+    prototype.set("color", "red");
+    counting_map::lookup_handle color("color");
+    assert(instance.get(color) == "red");
+
+    counting_map other_prototype;
+    counting_map other(&other_prototype);
+    for (int i = 0; i < 10; ++i) {
+        other_prototype.set(std::string(1, char('a' + i)), "value");
+        assert(other.get("a") == "value");
+        counting_less::count = 0;
+        assert(instance.get(color) == "red");
+        assert(counting_less::count == 0);
+    }
+
+    prototype.set("size", "large");
+    counting_less::count = 0;
+    assert(instance.get(color) == "red");
+    assert(counting_less::count != 0);
+}
+
+template <class Map>
+void test_freeze()
+{
+    Map maps[3];
+    maps[1].prototype(&maps[0]);
+    maps[2].prototype(&maps[1]);
+    maps[0].set("left", "red");
+    maps[0].set("right", "blue");
+    maps[1].set("right", "black");
+    maps[2].set("top", "yellow");
+    assert(maps[2].get("left") == "red");
+
+    Map other(&maps[1]);
+    maps[2].freeze();
+    assert(maps[0].frozen() && maps[1].frozen() && maps[2].frozen());
+    assert(!other.frozen());
+    assert(maps[2].get("left") == "red");
+    assert(maps[2].get("right") == "black");
+    assert(maps[2].get("top") == "yellow");
+    assert(maps[2].get_ptr("bottom") == 0);
+    assert(&maps[2].get("right") == maps[1].get_local_ptr("right"));
+    assert(maps[1].get_ptr("top") == 0);
+
+    try {
+        maps[0].set("left", "green");
+        assert(false);
+    } catch (std::logic_error const &) { }
+    try {
+        maps[1].erase("right");
+        assert(false);
+    } catch (std::logic_error const &) { }
+    try {
+        maps[2].prototype(0);
+        assert(false);
+    } catch (std::logic_error const &) { }
+    assert(maps[2].get("left") == "red");
+
+    // Maps that inherit from frozen maps still change, and edits elsewhere
+    // leave the frozen tables alone.
+    other.set("bottom", "white");
+    other.erase("bottom");
+    assert(other.get("right") == "black");
+    Map copy(maps[2]);
+    assert(!copy.frozen());
+    copy.set("left", "green");
+    assert(copy.get("left") == "green" && maps[2].get("left") == "red");
+
+    typename Map::lookup_handle handle("right");
+    assert(maps[2].get(handle) == "black");
+}
+
+int main(int argc, char *argv[])
+{
+    test_prototype();
+    test_invalidation();
+    test_lookup_handle();
+    test_lookup_handle_reuse();
+    test_unrelated_edits();
+    test_freeze<map_type>();
+    test_freeze<elemel::property_map<
+        std::string, std::string,
+        elemel::hash_map<std::string, std::string>,
+        elemel::hash_map<std::string, std::string const *>
+    > >();
     return 0;
 }
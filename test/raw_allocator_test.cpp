@@ -0,0 +1,231 @@
+#include <elemel/const_string.hpp>
+#include <elemel/copying_vector.hpp>
+#include <elemel/flat_map.hpp>
+#include <elemel/intern.hpp>
+#include <elemel/raw_allocator.hpp>
+#include <elemel/raw_allocator_adapter.hpp>
+#include <elemel/string_ptr.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(ELEMEL_NO_CXX11)
+#include <thread>
+#endif
+
+bool is_aligned(void *p)
+{
+    return reinterpret_cast<std::size_t>(p) % elemel::arena::alignment == 0;
+}
+
+void test_arena()
+{
+    elemel::arena a(1024);
+    char *first = static_cast<char *>(a.allocate(1));
+    char *second = static_cast<char *>(a.allocate(1));
+    assert(is_aligned(first) && is_aligned(second));
+    assert(second == first + elemel::arena::alignment);
+
+    // A large allocation gets a chunk of its own.
+    char *large = static_cast<char *>(a.allocate(4096));
+    assert(is_aligned(large));
+    large[4095] = 'x';
+    char *third = static_cast<char *>(a.allocate(1));
+    assert(third == second + elemel::arena::alignment);
+
+    for (int i = 0; i < 1000; ++i) {
+        assert(is_aligned(a.allocate(i)));
+    }
+    // Reset keeps a single chunk and starts over at its beginning.
+    a.reset();
+    char *fourth = static_cast<char *>(a.allocate(1));
+    char *fifth = static_cast<char *>(a.allocate(1));
+    assert(is_aligned(fourth));
+    assert(fifth == fourth + elemel::arena::alignment);
+}
+
+void test_arena_strings()
+{
+    typedef elemel::basic_const_string<char, std::char_traits<char>, long,
+                                       elemel::raw_arena_allocator>
+        string_type;
+    typedef elemel::basic_string_ptr<char, std::char_traits<char>, long,
+                                     elemel::raw_arena_allocator>
+        string_ptr_type;
+
+    elemel::arena a;
+    {
+        elemel::raw_arena_allocator alloc(a);
+        string_type s("a string that is stored in the arena", alloc);
+        string_type t(s);
+        string_ptr_type p("a string pointer that is stored in the arena",
+                          alloc);
+        assert(t == "a string that is stored in the arena");
+        assert(std::string(p.c_str()) ==
+               "a string pointer that is stored in the arena");
+    }
+    a.reset();
+
+    string_type u("a string in the arena of this thread");
+    assert(u == "a string in the arena of this thread");
+    assert(elemel::raw_arena_allocator() ==
+           elemel::raw_arena_allocator(elemel::thread_arena()));
+}
+
+void test_arena_intern()
+{
+    typedef elemel::basic_const_string<char, std::char_traits<char>, long,
+                                       elemel::raw_arena_allocator>
+        string_type;
+
+    string_type s = elemel::intern(string_type("an interned arena string"));
+    elemel::thread_arena().reset();
+    std::vector<string_type> v(4,
+                               string_type("a string that reuses the arena"));
+    for (int i = 0; i < 4; ++i) {
+        v.push_back(string_type("another string that reuses the arena"));
+    }
+    assert(s == "an interned arena string");
+    assert(elemel::intern(string_type("an interned arena string")).data() ==
+           s.data());
+}
+
+void test_adapter()
+{
+    typedef elemel::raw_allocator_adapter<std::pair<int, int>,
+                                          elemel::raw_arena_allocator>
+        allocator_type;
+
+    elemel::arena a;
+    allocator_type alloc((elemel::raw_arena_allocator(a)));
+    elemel::copying_vector<std::pair<int, int>, allocator_type> v(alloc);
+    elemel::flat_map<int, int, std::less<int>, allocator_type> m(
+        std::less<int>(), alloc);
+    for (int i = 0; i < 1000; ++i) {
+        v.push_back(std::make_pair(i, i));
+        m[i * 7 % 1000] = i;
+    }
+    assert(v.size() == 1000 && v[999].second == 999);
+    assert(m.size() == 1000 && m[7] == 1);
+    assert(v.get_allocator() == alloc);
+
+    elemel::copying_vector<int, elemel::raw_allocator_adapter<int> > w;
+    w.resize(100, 1);
+    assert(w[99] == 1);
+}
+
+void test_pool_classes()
+{
+    using elemel::detail::pool_class;
+    using elemel::detail::pool_class_size;
+
+    for (std::size_t n = 0; n <= 4096 - elemel::detail::pool_header_size;
+         ++n)
+    {
+        std::size_t c = pool_class(n);
+        assert(c < elemel::detail::pool_class_count);
+        assert(n + elemel::detail::pool_header_size <= pool_class_size(c));
+        assert(c == 0 || n + elemel::detail::pool_header_size >
+               pool_class_size(c - 1));
+    }
+    assert(pool_class(4096) == elemel::detail::pool_large_class);
+}
+
+void test_pool()
+{
+    elemel::raw_pool_allocator alloc;
+    std::vector<char *> blocks;
+    for (std::size_t i = 0; i < 5000; ++i) {
+        std::size_t n = i * 7 % 5000;
+        char *p = static_cast<char *>(alloc.allocate(n));
+        assert(is_aligned(p));
+        std::memset(p, int(i), n);
+        blocks.push_back(p);
+    }
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        std::size_t n = i * 7 % 5000;
+        assert(n == 0 || blocks[i][n - 1] == char(i));
+        alloc.deallocate(blocks[i]);
+    }
+
+    // Freed blocks are reused by the same thread.
+    void *p = alloc.allocate(40);
+    alloc.deallocate(p);
+    assert(alloc.allocate(40) == p);
+    alloc.deallocate(p);
+}
+
+void test_pool_strings()
+{
+    typedef elemel::basic_const_string<char, std::char_traits<char>, long,
+                                       elemel::raw_pool_allocator>
+        string_type;
+
+    std::vector<string_type> strings;
+    for (int i = 0; i < 1000; ++i) {
+        strings.push_back(string_type(std::string(i % 100, 'x').c_str()));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        assert(strings[i].size() == std::size_t(i % 100));
+    }
+}
+
+#if !defined(ELEMEL_NO_CXX11)
+void allocate_blocks(std::vector<void *> *blocks)
+{
+    elemel::raw_pool_allocator alloc;
+    for (std::size_t i = 0; i < blocks->size(); ++i) {
+        (*blocks)[i] = alloc.allocate(i % 300);
+    }
+}
+
+void deallocate_blocks(std::vector<void *> *blocks)
+{
+    elemel::raw_pool_allocator alloc;
+    for (std::size_t i = 0; i < blocks->size(); ++i) {
+        alloc.deallocate((*blocks)[i]);
+    }
+}
+
+// Blocks allocated by one thread can be freed by another.
+void test_pool_threads()
+{
+    std::vector<std::vector<void *> > blocks(4, std::vector<void *>(10000));
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            threads.push_back(std::thread(allocate_blocks, &blocks[i]));
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        threads.clear();
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            threads.push_back(std::thread(deallocate_blocks,
+                                          &blocks[(i + 1) % blocks.size()]));
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+    }
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    test_arena();
+    test_arena_strings();
+    test_arena_intern();
+    test_adapter();
+    test_pool_classes();
+    test_pool();
+    test_pool_strings();
+#if !defined(ELEMEL_NO_CXX11)
+    test_pool_threads();
+#endif
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <elemel/property_map.hpp>
+#include <elemel/shaped_storage.hpp>
+
+#include <cassert>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(ELEMEL_NO_CXX11)
+#include <thread>
+#endif
+
+typedef elemel::shaped_storage<std::string, int> storage_type;
+
+std::string key(int i)
+{
+    std::ostringstream out;
+    out << "key" << i;
+    return out.str();
+}
+
+void test_shapes()
+{
+    storage_type a;
+    storage_type b;
+    assert(a.shape() == b.shape() && a.empty() && a.begin() == a.end());
+    a["x"] = 1;
+    a["y"] = 2;
+    b["x"] = 3;
+    assert(a.shape() != b.shape() && a.shape()->parent() == b.shape());
+    b["y"] = 4;
+    assert(a.shape() == b.shape());
+    assert(a["x"] == 1 && b["y"] == 4 && b.size() == 2);
+
+    // Other keys branch off the shared shape.
+    storage_type c(b);
+    c["z"] = 5;
+    storage_type d;
+    d["x"] = 6;
+    d["w"] = 7;
+    assert(d.count("x") && d.count("w") && !d.count("y"));
+    assert(a.count("x") && a.count("y") && !a.count("w") && !a.count("z"));
+    assert(c.count("z") && c.shape()->parent() == a.shape());
+
+    c.erase("x");
+    assert(c.size() == 2 && c["y"] == 4 && c["z"] == 5 && !c.count("x"));
+    storage_type e;
+    e["y"] = 0;
+    e["z"] = 0;
+    assert(c.shape() == e.shape());
+
+    // Iteration is in insertion order.
+    storage_type::const_iterator i = c.begin();
+    assert(i->first == "y" && i->second == 4);
+    ++i;
+    assert(i->first == "z" && (*i).second == 5);
+    ++i;
+    assert(i == c.end());
+
+    c.clear();
+    assert(c.empty() && c.shape() == storage_type().shape());
+    c = a;
+    assert(c.shape() == a.shape() && c["y"] == 2);
+}
+
+// A linear congruential generator, since std::rand() may not be called from
+// several threads.
+int random(unsigned long &seed)
+{
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return int(seed >> 16);
+}
+
+// Checks inserts and erases against std::map, with storages that share and
+// abandon shapes.
+void check_random(unsigned long seed)
+{
+    storage_type storages[4];
+    std::map<std::string, int> expected[4];
+    for (int i = 0; i < 4000; ++i) {
+        int j = random(seed) % 4;
+        std::string k = key(random(seed) % 20);
+        if (random(seed) % 3 != 0) {
+            storages[j][k] = i;
+            expected[j][k] = i;
+        } else {
+            assert(storages[j].erase(k) == expected[j].erase(k));
+        }
+
+        std::map<std::string, int> values;
+        for (storage_type::iterator l = storages[j].begin();
+             l != storages[j].end(); ++l)
+        {
+            values[l->first] = l->second;
+        }
+        assert(values == expected[j]);
+    }
+}
+
+void test_random()
+{
+    check_random(1);
+}
+
+#if !defined(ELEMEL_NO_CXX11)
+// Threads add and release shapes in the same tree, while they look up the
+// keys of theirs.
+void test_threads()
+{
+    std::vector<std::thread> threads;
+    for (unsigned long i = 0; i < 4; ++i) {
+        threads.push_back(std::thread(check_random, i + 2));
+    }
+    for (std::size_t i = 0; i != threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+#endif
+
+void test_lookup_handle()
+{
+    storage_type a;
+    storage_type b;
+    for (int i = 0; i < 40; ++i) {
+        a[key(i)] = i;
+        b[key(i)] = -i;
+    }
+    storage_type c(a);
+    c.erase(key(0));
+
+    storage_type::lookup_handle handle(key(30));
+    assert(a.find(handle)->second == 30);
+    assert(b.find(handle)->second == -30);
+    assert(c.find(handle)->second == 30);
+    assert(a.find(handle)->second == 30);
+
+    storage_type::lookup_handle missing("missing");
+    assert(a.find(missing) == a.end() && c.find(missing) == c.end());
+    c["missing"] = 1;
+    assert(c.find(missing)->second == 1 && a.find(missing) == a.end());
+}
+
+void test_property_map()
+{
+    typedef elemel::property_map<
+        std::string, std::string,
+        elemel::shaped_storage<std::string, std::string>
+    > map_type;
+
+    map_type prototype;
+    prototype.set("color", "red");
+    prototype.set("size", "large");
+    map_type instances[100];
+    for (int i = 0; i < 100; ++i) {
+        instances[i].prototype(&prototype);
+        instances[i].set("name", key(i));
+    }
+    assert(instances[42].get("name") == "key42");
+    assert(instances[42].get("color") == "red");
+    instances[42].erase("name");
+    assert(instances[42].get_ptr("name") == 0);
+    prototype.set("name", "default");
+    assert(instances[42].get("name") == "default");
+    assert(instances[43].get("name") == "key43");
+}
+
+int main(int argc, char *argv[])
+{
+    test_shapes();
+    test_random();
+#if !defined(ELEMEL_NO_CXX11)
+    test_threads();
+#endif
+    test_lookup_handle();
+    test_property_map();
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <elemel/string_ptr.hpp>
+#include <elemel/ref_count.hpp>
 
 #include <cassert>
+#include <functional>
 #include <string>
 
 void test_compare()
@@ -69,8 +71,105 @@ void test_compare()
     assert("foo" > elemel::string_ptr("bar"));
 }
 
+template <class RefCount>
+void test_ref_count()
+{
+    typedef elemel::basic_string_ptr<char, std::char_traits<char>, RefCount> string_type;
+    string_type a("foo");
+    {
+        string_type b(a);
+        string_type c("bar");
+        c = b;
+        c.share();
+        string_type d(c);
+        assert(d == "foo");
+    }
+    assert(a == "foo");
+}
+
+void test_hash()
+{
+    elemel::string_ptr a("foo");
+    elemel::string_ptr b(std::string("foo").c_str());
+    assert(a.hash() == b.hash());
+    assert(a.hash() == elemel::hash_string("foo"));
+    assert(a.hash() != elemel::string_ptr("bar").hash());
+}
+
+template <class Char>
+void test_inline()
+{
+    typedef elemel::basic_string_ptr<Char> string_type;
+    assert(sizeof(string_type) == 3 * sizeof(void *));
+    string_type empty;
+    assert(empty.is_inline() && empty.size() == 0 && empty.c_str()[0] == 0);
+
+    std::basic_string<Char> chars;
+    for (std::size_t n = 0; n < 40; ++n) {
+        string_type a(chars.c_str());
+        assert(a.is_inline() == (n <= string_type::inline_capacity));
+        assert(a.size() == n);
+        assert(a.c_str() == chars && a.c_str()[n] == 0);
+        string_type b(a);
+        assert(b == a && b.hash() == a.hash());
+        if (n != 0) {
+            // Same size, with and without the hash check.
+            std::basic_string<Char> other(chars);
+            other[n - 1] = Char('z' + 1);
+            string_type c(other.c_str());
+            assert(c.is_inline() == a.is_inline());
+            assert(c != a && !(c == a) && c == string_type(other.c_str()));
+        }
+        b = empty;
+        assert(b.size() == 0);
+        b = a;
+        a = empty;
+        assert(b.c_str() == chars);
+        chars.push_back(Char('a' + n % 26));
+    }
+}
+
+int sign(int n)
+{
+    return (n > 0) - (n < 0);
+}
+
+template <class Char>
+void test_three_way()
+{
+    typedef elemel::basic_string_ptr<Char> string_ptr_type;
+    typedef std::basic_string<Char> string_type;
+
+    string_type strs[] = {
+        string_type(), string_type(1, Char('a')), string_type(1, Char(200)),
+        string_type(40, Char('a')), string_type(39, Char('a')) + Char('b')
+    };
+    std::size_t n = sizeof(strs) / sizeof(*strs);
+    for (std::size_t i = 0; i != n; ++i) {
+        string_ptr_type a(strs[i].c_str());
+        for (std::size_t j = 0; j != n; ++j) {
+            string_ptr_type b(strs[j].c_str());
+            int expected = sign(strs[i].compare(strs[j]));
+            assert(sign(a.compare(b)) == expected);
+            assert(sign(a.compare(strs[j].c_str())) == expected);
+            assert((a < b) == (expected < 0));
+            assert((a == b) == (expected == 0));
+        }
+    }
+    assert(elemel::detail::three_way_compare<
+           std::less<string_ptr_type> >::value);
+}
+
 int main(int argc, char *argv[])
 {
     test_compare();
+    test_ref_count<long>();
+    test_ref_count<elemel::atomic_ref_count>();
+    test_ref_count<elemel::deferred_ref_count>();
+    test_hash();
+    test_inline<char>();
+    test_inline<wchar_t>();
+    test_three_way<char>();
+    test_three_way<wchar_t>();
     return 0;
 }
@@ -1,7 +1,9 @@
 #include <elemel/string_range.hpp>
 
 #include <cassert>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 void test_compare()
 {
@@ -69,8 +71,167 @@ void test_compare()
     assert("foo" > elemel::string_range("bar"));
 }
 
+int sign(int n)
+{
+    return (n > 0) - (n < 0);
+}
+
+// Compares ranges with terminated strings that differ at every position of
+// the vectorized blocks.
+void test_compare_terminated()
+{
+    std::string str;
+    for (int i = 0; i < 100; ++i) {
+        str += char('a' + i % 26);
+    }
+    for (std::size_t n = 0; n <= str.size(); ++n) {
+        elemel::string_range range(str.data(), n);
+        std::string prefix(str, 0, n);
+        for (std::size_t m = 0; m <= str.size(); m += 7) {
+            std::string other(str, 0, m);
+            if (m != 0 && m % 2 == 0) {
+                other[m - 1] = '\xff';
+            }
+            int expected = sign(prefix.compare(other));
+            assert((range == other.c_str()) == (expected == 0));
+            assert((other.c_str() == range) == (expected == 0));
+            assert((range < other.c_str()) == (expected < 0));
+            assert((other.c_str() < range) == (expected > 0));
+        }
+    }
+
+    // C strings that cross a page boundary, with differences before and
+    // after it.
+    std::vector<char> buffer(3 * 4096);
+    char *page = &buffer[0] + (4096 - reinterpret_cast<std::size_t>(
+        &buffer[0]) % 4096);
+    for (std::size_t offset = 1; offset <= 40; ++offset) {
+        char *c_str = page + 4096 - offset;
+        for (std::size_t diff = 0; diff <= 200; diff += 13) {
+            std::string chars(str + str, 0, 200);
+            chars.copy(c_str, 200);
+            c_str[200] = '\0';
+            std::string other(chars);
+            if (diff < 200) {
+                other[diff] = 'A';
+            }
+            elemel::string_range range(other.data(), other.size());
+            int expected = sign(other.compare(c_str));
+            assert((range == c_str) == (expected == 0));
+            assert((range < c_str) == (expected < 0));
+            assert((c_str < range) == (expected > 0));
+        }
+    }
+
+    // A range with an embedded terminator is longer than the string.
+    char const embedded[] = "foo\0bar";
+    assert(elemel::string_range(embedded, 4) != "foo");
+    assert(elemel::string_range(embedded, 4) > "foo");
+    assert("foo" < elemel::string_range(embedded, 4));
+}
+
+void test_empty()
+{
+    assert(elemel::string_range().empty());
+    assert(elemel::string_range("").empty());
+    assert(!elemel::string_range("foo").empty());
+}
+
+// Checks the search functions against std::string on strings that are long
+// enough to cover the vectorized loops and their tails.
+template <class Char>
+void test_find()
+{
+    typedef std::basic_string<Char> string_type;
+    typedef elemel::basic_string_range<Char> range_type;
+
+    string_type str;
+    for (int i = 0; i < 200; ++i) {
+        str += Char('a' + i * i % 7);
+    }
+    range_type range(str.data(), str.size());
+    for (std::size_t pos = 0; pos <= str.size() + 1; ++pos) {
+        for (int c = 'a' - 1; c <= 'h'; ++c) {
+            assert(range.find(Char(c), pos) == str.find(Char(c), pos));
+            assert(range.rfind(Char(c), pos) == str.rfind(Char(c), pos));
+        }
+        assert(range.rfind(Char('a')) == str.rfind(Char('a')));
+    }
+
+    string_type needles[] = {
+        string_type(), str.substr(0, 1), str.substr(3, 2), str.substr(190),
+        str.substr(50, 40), str.substr(10, 5) + Char('x'), str + str
+    };
+    for (std::size_t i = 0; i != sizeof(needles) / sizeof(*needles); ++i) {
+        range_type needle(needles[i].data(), needles[i].size());
+        for (std::size_t pos = 0; pos <= str.size() + 1; pos += 3) {
+            assert(range.find(needle, pos) == str.find(needles[i], pos));
+            assert(range.rfind(needle, pos) == str.rfind(needles[i], pos));
+            assert(range.find_first_of(needle, pos) ==
+                   str.find_first_of(needles[i], pos));
+        }
+        assert(range.rfind(needle) == str.rfind(needles[i]));
+    }
+
+    string_type set;
+    for (int c = 'z'; c != 'f'; --c) {
+        set += Char(c);
+        assert(range.find_first_of(range_type(set.data(), set.size())) ==
+               str.find_first_of(set));
+    }
+}
+
+void test_substr()
+{
+    elemel::string_range range("foobar");
+    assert(range.substr(3) == "bar");
+    assert(range.substr(1, 2) == "oo");
+    assert(range.substr(6).empty());
+    try {
+        range.substr(7);
+        assert(false);
+    } catch (std::out_of_range const &) { }
+}
+
+void test_split()
+{
+    typedef std::vector<elemel::string_range> vector_type;
+
+    elemel::split_range split = elemel::string_range("a,bc,,d,").split(',');
+    vector_type slices(split.begin(), split.end());
+    assert(slices.size() == 5);
+    assert(slices[0] == "a");
+    assert(slices[1] == "bc");
+    assert(slices[2] == "");
+    assert(slices[3] == "d");
+    assert(slices[4] == "");
+
+    split = elemel::string_range("").split(',');
+    assert(vector_type(split.begin(), split.end()).size() == 1);
+
+    std::string line;
+    for (int i = 0; i < 100; ++i) {
+        line += "token ";
+    }
+    std::size_t count = 0;
+    split = elemel::string_range(line.c_str()).split(' ');
+    for (elemel::split_range::const_iterator i = split.begin();
+         i != split.end(); ++i)
+    {
+        assert(count == 100 ? i->empty() : *i == "token");
+        ++count;
+    }
+    assert(count == 101);
+}
+
 int main(int argc, char *argv[])
 {
     test_compare();
+    test_compare_terminated();
+    test_empty();
+    test_find<char>();
+    test_find<wchar_t>();
+    test_substr();
+    test_split();
     return 0;
 }